@@ -0,0 +1,289 @@
+#include "BatchRunner.hpp"
+#include "BoundedQueue.hpp"
+#include "../graph/GraphFile.hpp"
+#include "../graph/RawImage.hpp"
+#include "../nodes/NodeFactory.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+struct DecodedImage {
+    std::string path;
+    cv::Mat image;
+};
+
+struct PendingWrite {
+    std::shared_ptr<OutputNode> sink;
+    std::string basePath;  // Output path without extension; the sink adds its format's
+    cv::Mat image;
+};
+
+bool isImageFile(const std::filesystem::path& path) {
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    static const char* known[] = {".jpg", ".jpeg", ".png", ".bmp", ".tif", ".tiff", ".webp",
+                                  ".ppm", ".pgm", ".pbm", ".exr", ".hdr", ".jp2", ".ngraw"};
+    return std::find(std::begin(known), std::end(known), extension) != std::end(known);
+}
+
+}
+
+BatchRunner::BatchRunner(const BatchOptions& options) : options(options) {}
+
+bool BatchRunner::setUp() {
+    if (!loadGraph(options.graphPath, graph, createNode)) {
+        return false;
+    }
+
+    for (const auto& node : graph.getNodes()) {
+        bool wanted = !source && !video && (options.inputNode.empty() || node->name == options.inputNode);
+        if (auto input = std::dynamic_pointer_cast<ImageInputNode>(node)) {
+            if (wanted) {
+                source = input;
+            }
+        } else if (auto footage = std::dynamic_pointer_cast<VideoInputNode>(node)) {
+            if (wanted) {
+                video = footage;
+            }
+        } else if (auto output = std::dynamic_pointer_cast<OutputNode>(node)) {
+            output->setSaveOnProcess(false);  // Written by the encoder threads instead
+            sinks.push_back(output);
+        }
+    }
+    if (!source && !video) {
+        std::cerr << "Graph has no ImageInput or VideoInput node"
+                  << (options.inputNode.empty() ? "" : " named " + options.inputNode) << "!" << std::endl;
+        return false;
+    }
+    if (sinks.empty()) {
+        std::cerr << "Graph has no Output node, nothing would be written!" << std::endl;
+        return false;
+    }
+
+    graph.setInteractive(false);
+    graph.setWorkerCount(options.workers);
+    graph.setBufferPoolEnabled(true);
+    graph.setReleaseIntermediates(true);
+    graph.setFusionEnabled(true);
+    graph.setLazyEvaluation(true);  // Branches that feed no Output node are skipped
+    graph.setProfilingEnabled(!options.tracePath.empty());
+    return true;
+}
+
+std::vector<std::string> BatchRunner::listInputs() const {
+    std::vector<std::string> files;
+    std::error_code error;
+    if (std::filesystem::is_directory(options.input, error)) {
+        for (const auto& entry : std::filesystem::directory_iterator(options.input, error)) {
+            if (entry.is_regular_file() && isImageFile(entry.path())) {
+                files.push_back(entry.path().string());
+            }
+        }
+    } else {
+        std::vector<std::string> matches;
+        try {
+            cv::glob(options.input, matches, false);
+        } catch (const cv::Exception& e) {
+            std::cerr << "Cannot list " << options.input << ": " << e.what() << std::endl;
+        }
+        files.assign(matches.begin(), matches.end());
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+int BatchRunner::run() {
+    if (!setUp()) {
+        return -1;
+    }
+
+    std::vector<std::string> files;
+    if (source) {
+        files = listInputs();
+        if (files.empty()) {
+            std::cerr << "No input images found in " << options.input << std::endl;
+            return -1;
+        }
+    }
+    std::error_code error;
+    std::filesystem::create_directories(options.outputDir, error);
+    if (error) {
+        std::cerr << "Cannot create output directory " << options.outputDir << ": " << error.message() << std::endl;
+        return -1;
+    }
+
+    if (video) {
+        video->applyParams({{"sourcePath", options.input}});
+        video->setPrefetch(std::max<size_t>(1, options.queueCapacity));
+        std::cout << "Batch: frames of " << options.input << ", " << options.encoders << " encoders, "
+                  << options.workers << " graph workers\n";
+    } else {
+        std::cout << "Batch: " << files.size() << " images, " << options.decoders << " decoders, "
+                  << options.encoders << " encoders, " << options.workers << " graph workers\n";
+    }
+    auto started = std::chrono::steady_clock::now();
+
+    BoundedQueue<DecodedImage> decoded(options.queueCapacity);
+    BoundedQueue<PendingWrite> pending(options.queueCapacity);
+    std::atomic<size_t> nextFile{0};
+    std::atomic<size_t> failures{0};
+    std::atomic<size_t> written{0};
+    size_t evaluated = 0;
+
+    // Decoders: claim files in order, push decoded images; the last one out closes the queue.
+    // Footage is decoded ahead by the VideoInput node's own thread instead.
+    const size_t decoderCount = video ? 0 : std::max<size_t>(1, options.decoders);
+    std::atomic<size_t> activeDecoders{decoderCount};
+    std::vector<std::thread> threads;
+    for (size_t d = 0; d < decoderCount; ++d) {
+        threads.emplace_back([&] {
+            for (size_t i = nextFile++; i < files.size(); i = nextFile++) {
+                cv::Mat image = readImage(files[i], cv::IMREAD_UNCHANGED);
+                if (image.empty()) {
+                    std::cerr << "Failed to decode " << files[i] << std::endl;
+                    ++failures;
+                    continue;
+                }
+                if (!decoded.push({files[i], image})) {
+                    break;
+                }
+            }
+            if (--activeDecoders == 0) {
+                decoded.close();
+            }
+        });
+    }
+
+    // Encoders: write whatever the graph finished.
+    for (size_t e = 0; e < std::max<size_t>(1, options.encoders); ++e) {
+        threads.emplace_back([&] {
+            PendingWrite write;
+            while (pending.pop(write)) {
+                if (write.sink->save(write.image, write.basePath)) {
+                    ++written;
+                } else {
+                    ++failures;
+                }
+                write = PendingWrite();  // Drop the image before waiting for the next one
+            }
+        });
+    }
+
+    // Hands every sink's result of the last evaluation to the encoders, named after `stem`.
+    auto submitResults = [&](const std::string& stem, const std::string& from) {
+        for (const auto& sink : sinks) {
+            cv::Mat result = graph.getNodeOutput(sink);
+            if (result.empty()) {
+                std::cerr << "Graph produced no image for " << sink->name << " from " << from << std::endl;
+                ++failures;
+                continue;
+            }
+            std::string name = sinks.size() > 1 ? stem + "_" + sink->name : stem;
+            pending.push({sink, (std::filesystem::path(options.outputDir) / name).string(), result});
+        }
+    };
+
+    // Results handed to the encoders must not be overwritten in place by the next run.
+    auto releaseResults = [&] {
+        for (const auto& node : graph.getNodes()) {
+            node->releaseOutputs();
+        }
+    };
+
+    // A node that throws on one input (an unsupported format, mismatched sizes) fails that
+    // image or frame only; the batch goes on with the next one.
+    auto runGraph = [&](const std::string& from) {
+        try {
+            graph.run();
+            return true;
+        } catch (const std::exception& e) {
+            std::cerr << "Graph failed on " << from << ": " << e.what() << std::endl;
+        } catch (...) {
+            std::cerr << "Graph failed on " << from << std::endl;
+        }
+        ++failures;
+        releaseResults();
+        return false;
+    };
+
+    // The graph itself runs on this thread, one image or frame at a time. Whatever ends the
+    // loop, the queues are closed and the pipeline threads joined before leaving.
+    std::exception_ptr thrown;
+    try {
+        if (video) {
+            for (long long frame = 0;; ++frame) {
+                releaseResults();
+                video->setFrame(frame);
+                bool ran = runGraph("frame " + std::to_string(frame));
+                if (video->isDirty()) {
+                    // Still dirty after a failed run means the throw came before the video was
+                    // read, so the next frame would fail the same way.
+                    if (ran) {
+                        std::cerr << "VideoInput node " << video->name << " feeds no Output node!" << std::endl;
+                        ++failures;
+                    }
+                    break;
+                }
+                if (video->isAtEnd()) {
+                    break;
+                }
+                if (!ran) {
+                    continue;
+                }
+
+                std::ostringstream stem;
+                stem << std::setw(6) << std::setfill('0') << frame;
+                submitResults(stem.str(), "frame " + std::to_string(frame));
+                ++evaluated;
+            }
+            if (evaluated == 0) {
+                std::cerr << "No frames decoded from " << options.input << std::endl;
+                ++failures;
+            }
+        } else {
+            DecodedImage item;
+            while (decoded.pop(item)) {
+                releaseResults();
+                source->setImage(item.image);
+                item.image.release();
+                if (!runGraph(item.path)) {
+                    continue;
+                }
+
+                submitResults(std::filesystem::path(item.path).stem().string(), item.path);
+                ++evaluated;
+            }
+        }
+    } catch (...) {
+        thrown = std::current_exception();
+    }
+    decoded.close();  // Stops the decoders early when the loop ended before the input did
+    pending.close();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (thrown) {
+        std::rethrow_exception(thrown);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    std::cout << "Batch done: " << written << " files written, " << failures << " failures in " << seconds
+              << " s (" << (seconds > 0 ? evaluated / seconds : 0.0) << (video ? " frames/s)\n" : " images/s)\n");
+
+    if (!options.tracePath.empty()) {
+        graph.getProfiler().printSummary(std::cout);
+        graph.getProfiler().writeChromeTrace(options.tracePath);
+    }
+    return static_cast<int>(failures.load());
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "../graph/NodeGraph.hpp"
+#include "../nodes/ImageInputNode.hpp"
+#include "../nodes/OutputNode.hpp"
+#include "../nodes/VideoInputNode.hpp"
+
+struct BatchOptions {
+    std::string graphPath;
+    std::string input;          // Directory, or a glob pattern such as "shots/*.png"; for a graph fed
+                                // by a VideoInput node, a video file or a pattern like "shots/%04d.png"
+    std::string outputDir;
+    std::string inputNode;      // ImageInput or VideoInput node fed with the input; empty picks the first one
+    size_t decoders = 2;        // Threads reading and decoding images
+    size_t encoders = 2;        // Threads encoding and writing results
+    size_t queueCapacity = 4;   // Images waiting between two stages; frames a video source decodes ahead
+    size_t workers = 1;         // NodeGraph workers for each evaluation
+    std::string tracePath;      // Chrome trace of the graph evaluations; empty for none
+};
+
+// Runs a saved graph over every image in a directory or glob, headless. Decoding, graph
+// evaluation and encoding run as a pipeline over bounded queues: decoder threads read ahead
+// while the graph evaluates one image, and encoder threads write the previous results.
+// Every OutputNode in the graph produces one file per image in the output directory, named
+// after the input file (plus the node name when there are several), in the node's format.
+//
+// Graphs whose source is a VideoInput node run once per frame instead: the node's decoder
+// thread reads frame N+1 while the graph evaluates frame N and the encoders write frame N-1.
+// Files are named after the frame number.
+class BatchRunner {
+public:
+    explicit BatchRunner(const BatchOptions& options);
+
+    // Returns the number of images that failed, or -1 if the batch could not start.
+    int run();
+
+private:
+    bool setUp();
+    std::vector<std::string> listInputs() const;
+
+    BatchOptions options;
+    NodeGraph graph;
+    std::shared_ptr<ImageInputNode> source;
+    std::shared_ptr<VideoInputNode> video;  // Set instead of source for footage
+    std::vector<std::shared_ptr<OutputNode>> sinks;
+};
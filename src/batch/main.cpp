@@ -0,0 +1,58 @@
+#include "BatchRunner.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// Prints the command line this executable accepts
+static void printUsage() {
+    std::cerr << "Usage: batch <graph file> <input directory, glob or video> <output directory> [options]\n"
+              << "  --input-node <name>  ImageInput or VideoInput node fed with the input (default: the first)\n"
+              << "  --decoders <n>       decoder threads (default 2)\n"
+              << "  --encoders <n>       encoder threads (default 2)\n"
+              << "  --queue <n>          images buffered between stages, frames decoded ahead (default 4)\n"
+              << "  --workers <n>        graph worker threads, 0 = all cores (default 1)\n"
+              << "  --trace <file.json>  write a Chrome trace of the graph evaluations\n";
+}
+
+int main(int argc, char** argv) {
+    if (argc < 4) {
+        printUsage();
+        return 2;
+    }
+
+    BatchOptions options;
+    options.graphPath = argv[1];
+    options.input = argv[2];
+    options.outputDir = argv[3];
+
+    for (int i = 4; i < argc; ++i) {
+        std::string flag = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << flag << std::endl;
+            printUsage();
+            return 2;
+        }
+        std::string value = argv[++i];
+        if (flag == "--input-node") {
+            options.inputNode = value;
+        } else if (flag == "--decoders") {
+            options.decoders = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (flag == "--encoders") {
+            options.encoders = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (flag == "--queue") {
+            options.queueCapacity = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (flag == "--workers") {
+            options.workers = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (flag == "--trace") {
+            options.tracePath = value;
+        } else {
+            std::cerr << "Unknown option " << flag << std::endl;
+            printUsage();
+            return 2;
+        }
+    }
+
+    BatchRunner runner(options);
+    int failures = runner.run();
+    return failures == 0 ? 0 : 1;
+}
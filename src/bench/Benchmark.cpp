@@ -0,0 +1,276 @@
+#include "Benchmark.hpp"
+#include "../nodes/NodeFactory.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+
+namespace {
+
+std::string depthName(int depth) {
+    return depth == CV_8U ? "8u" : depth == CV_32F ? "32f" : std::to_string(depth);
+}
+
+std::string escapeCsv(const std::string& text) {
+    if (text.find_first_of(",\"\n") == std::string::npos) {
+        return text;
+    }
+    std::string escaped = "\"";
+    for (char c : text) {
+        escaped += c;
+        if (c == '"') {
+            escaped += '"';
+        }
+    }
+    return escaped + "\"";
+}
+
+// Comma-separated weights of a normalized size x size disc, a PSF that does not separate
+std::string discKernel(int size) {
+    const int r = size / 2;
+    int inside = 0;
+    for (int y = -r; y <= r; ++y) {
+        for (int x = -r; x <= r; ++x) {
+            inside += x * x + y * y <= r * r;
+        }
+    }
+    std::string weights;
+    for (int y = -r; y <= r; ++y) {
+        for (int x = -r; x <= r; ++x) {
+            weights += (weights.empty() ? "" : ",") + toParam(x * x + y * y <= r * r ? 1.0f / inside : 0.0f);
+        }
+    }
+    return weights;
+}
+
+std::string escapeJson(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else if (static_cast<unsigned char>(c) >= 0x20) {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+}
+
+std::vector<BenchmarkCase> benchmarkCases() {
+    std::vector<BenchmarkCase> cases;
+
+    for (int radius : {1, 5, 15}) {
+        cases.push_back({"Blur/gaussian/r" + std::to_string(radius), "Blur",
+                         {{"radius", toParam(radius)}, {"directional", toParam(false)}}});
+    }
+    for (int radius : {15, 60, 200}) {
+        cases.push_back({"Blur/box/r" + std::to_string(radius), "Blur",
+                         {{"radius", toParam(radius)}, {"directional", toParam(false)}, {"approximate", toParam(true)}}});
+    }
+    for (int radius : {1, 5, 15}) {
+        cases.push_back({"Blur/directional/r" + std::to_string(radius), "Blur",
+                         {{"radius", toParam(radius)}, {"directional", toParam(true)}, {"angle", toParam(30.0f)}}});
+    }
+
+    const char* presets[] = {"sharpen", "emboss", "edgeEnhance"};  // PresetType 1..3; all are 3x3
+    for (int preset = 1; preset <= 3; ++preset) {
+        cases.push_back({std::string("ConvolutionFilter/") + presets[preset - 1], "ConvolutionFilter",
+                         {{"preset", toParam(preset)}}});
+    }
+
+    const char* methods[] = {"auto", "direct"};  // ConvolutionFilterNode::Method::Auto, Direct
+    for (int size : {15, 31, 63}) {
+        for (int method : {0, 1}) {
+            cases.push_back({"ConvolutionFilter/disc" + std::to_string(size) + "/" + methods[method], "ConvolutionFilter",
+                             {{"kernelSize", toParam(size)}, {"kernel", discKernel(size)}, {"method", toParam(method)}}});
+        }
+        // A box is rank 1, so Auto finds it separable
+        std::string box;
+        for (int i = 0; i < size * size; ++i) {
+            box += (i ? "," : "") + toParam(1.0f / (size * size));
+        }
+        cases.push_back({"ConvolutionFilter/box" + std::to_string(size) + "/auto", "ConvolutionFilter",
+                         {{"kernelSize", toParam(size)}, {"kernel", box}}});
+    }
+
+    const char* thresholds[] = {"binary", "adaptive", "otsu"};  // ThresholdType order
+    for (int type = 0; type < 3; ++type) {
+        cases.push_back({std::string("Threshold/") + thresholds[type], "Threshold", {{"type", toParam(type)}}});
+    }
+
+    cases.push_back({"EdgeDetection/sobel", "EdgeDetection", {{"type", toParam(0)}}});
+    cases.push_back({"EdgeDetection/sobel/k1", "EdgeDetection", {{"type", toParam(0)}, {"sobelKernelSize", toParam(1)}}});
+    cases.push_back({"EdgeDetection/sobel/k7", "EdgeDetection", {{"type", toParam(0)}, {"sobelKernelSize", toParam(7)}}});
+    cases.push_back({"EdgeDetection/canny", "EdgeDetection", {{"type", toParam(1)}}});
+
+    const char* modes[] = {"normal", "multiply", "screen", "overlay", "difference"};  // BlendMode order
+    for (int mode = 0; mode < 5; ++mode) {
+        cases.push_back({std::string("Blend/") + modes[mode], "Blend", {{"mode", toParam(mode)}, {"opacity", toParam(0.5f)}}});
+    }
+
+    cases.push_back({"NoiseGenerator/color", "NoiseGenerator", {{"useAsDisplacement", toParam(false)}}});
+    cases.push_back({"NoiseGenerator/displacement", "NoiseGenerator", {{"useAsDisplacement", toParam(true)}}});
+
+    return cases;
+}
+
+std::vector<std::pair<std::string, cv::Size>> benchmarkSizes() {
+    return {{"256", cv::Size(256, 256)},
+            {"512", cv::Size(512, 512)},
+            {"1K", cv::Size(1024, 1024)},
+            {"2K", cv::Size(2048, 2048)},
+            {"4K", cv::Size(3840, 2160)},
+            {"8K", cv::Size(7680, 4320)}};
+}
+
+cv::Mat makeBenchmarkImage(const BenchmarkFormat& format, uint64_t seed) {
+    cv::Mat image(format.height, format.width, CV_MAKETYPE(format.depth, format.channels));
+    cv::RNG rng(seed);
+    rng.fill(image, cv::RNG::UNIFORM, 0, format.depth == CV_8U ? 256 : 1);
+    return image;
+}
+
+BenchmarkResult runBenchmark(const BenchmarkCase& benchmark, const BenchmarkFormat& format,
+                             const std::vector<cv::Mat>& images, const BenchmarkOptions& options) {
+    using Clock = std::chrono::steady_clock;
+
+    BenchmarkResult result;
+    result.name = benchmark.name;
+    result.format = format;
+
+    auto node = createNode(benchmark.type, "bench");
+    if (!node) {
+        result.error = "unknown node type " + benchmark.type;
+        return result;
+    }
+    node->setInteractive(false);
+    node->applyParams(benchmark.params);
+    std::vector<Node::Port> ports = node->getInputPorts();
+
+    // Inputs are set again before every run so nodes that convert their input in place
+    // always start from the original format.
+    auto runOnce = [&]() {
+        for (size_t i = 0; i < ports.size(); ++i) {
+            node->setInputPort(ports[i].name, images[std::min(i, images.size() - 1)]);
+        }
+        node->process();
+    };
+
+    std::vector<double> timesMs;
+    try {
+        runOnce();  // Warm-up: first-touch page faults, OpenCV's lazy initialisation
+        if (node->getOutputPort(node->getOutputPorts().front().name).empty()) {
+            result.error = "no output";
+            return result;
+        }
+
+        Clock::time_point start = Clock::now();
+        while (timesMs.size() < options.maxIterations) {
+            Clock::time_point begin = Clock::now();
+            runOnce();
+            Clock::time_point end = Clock::now();
+            timesMs.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+
+            double elapsed = std::chrono::duration<double>(end - start).count();
+            if (timesMs.size() >= options.minIterations && elapsed >= options.minSeconds) {
+                break;
+            }
+        }
+    } catch (const cv::Exception& e) {
+        result.error = e.err.empty() ? e.what() : e.err;
+        return result;
+    }
+
+    std::sort(timesMs.begin(), timesMs.end());
+    result.iterations = timesMs.size();
+    result.minMs = timesMs.front();
+    result.medianMs = timesMs[timesMs.size() / 2];
+    double megapixels = static_cast<double>(format.width) * format.height / 1e6;
+    result.megapixelsPerSecond = result.medianMs > 0 ? megapixels / (result.medianMs / 1000.0) : 0;
+    return result;
+}
+
+std::string verifyTiling(const BenchmarkCase& benchmark, const std::vector<cv::Mat>& images, int tileSize) {
+    auto node = createNode(benchmark.type, "verify");
+    if (!node) {
+        return "unknown node type " + benchmark.type;
+    }
+    node->setInteractive(false);
+    node->applyParams(benchmark.params);
+    if (!node->isTileable()) {
+        return std::string();
+    }
+    std::vector<Node::Port> ports = node->getInputPorts();
+    const std::string port = node->getOutputPorts().front().name;
+
+    auto runOn = [&](const cv::Rect& rect) {
+        for (size_t i = 0; i < ports.size(); ++i) {
+            node->setInputPort(ports[i].name, images[std::min(i, images.size() - 1)](rect));
+        }
+        node->setRegionOrigin(rect.tl());
+        node->process();
+        return node->getOutputPort(port).clone();
+    };
+
+    const cv::Rect frame(cv::Point(0, 0), images.front().size());
+    cv::Mat reference;
+    try {
+        reference = runOn(frame);
+        for (int y = 0; y < frame.height; y += tileSize) {
+            for (int x = 0; x < frame.width; x += tileSize) {
+                const cv::Rect tile = cv::Rect(x, y, tileSize, tileSize) & frame;
+                const cv::Rect required = node->getRequiredInputRect(tile) & frame;
+                cv::Mat tiled = runOn(required);
+                if (tiled.size() != required.size() || tiled.type() != reference.type()) {
+                    return "tile at " + std::to_string(x) + "," + std::to_string(y) + " has the wrong size or type";
+                }
+                double difference = cv::norm(tiled(tile - required.tl()), reference(tile), cv::NORM_INF);
+                if (difference > 0) {
+                    return "tile at " + std::to_string(x) + "," + std::to_string(y) + " differs by up to " + toParam(difference);
+                }
+            }
+        }
+    } catch (const cv::Exception& e) {
+        return e.err.empty() ? e.what() : e.err;
+    }
+    return std::string();
+}
+
+void writeJson(const std::vector<BenchmarkResult>& results, std::ostream& out) {
+    out << std::fixed << std::setprecision(4);
+    out << "{\"threads\":" << cv::getNumThreads() << ",\"results\":[";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult& r = results[i];
+        out << (i ? ",\n" : "\n")
+            << "{\"name\":\"" << escapeJson(r.name) << "\""
+            << ",\"width\":" << r.format.width << ",\"height\":" << r.format.height
+            << ",\"channels\":" << r.format.channels << ",\"depth\":\"" << depthName(r.format.depth) << "\"";
+        if (r.error.empty()) {
+            out << ",\"iterations\":" << r.iterations
+                << ",\"median_ms\":" << r.medianMs << ",\"min_ms\":" << r.minMs
+                << ",\"mpix_per_s\":" << r.megapixelsPerSecond << "}";
+        } else {
+            out << ",\"error\":\"" << escapeJson(r.error) << "\"}";
+        }
+    }
+    out << "\n]}\n";
+    out << std::defaultfloat;
+}
+
+void writeCsv(const std::vector<BenchmarkResult>& results, std::ostream& out) {
+    out << std::fixed << std::setprecision(4);
+    out << "name,width,height,channels,depth,iterations,median_ms,min_ms,mpix_per_s,error\n";
+    for (const BenchmarkResult& r : results) {
+        out << escapeCsv(r.name) << "," << r.format.width << "," << r.format.height << ","
+            << r.format.channels << "," << depthName(r.format.depth) << ",";
+        if (r.error.empty()) {
+            out << r.iterations << "," << r.medianMs << "," << r.minMs << "," << r.megapixelsPerSecond << ",\n";
+        } else {
+            out << ",,,," << escapeCsv(r.error) << "\n";
+        }
+    }
+    out << std::defaultfloat;
+}
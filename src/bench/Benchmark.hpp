@@ -0,0 +1,64 @@
+#pragma once
+#include "../graph/Params.hpp"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// One node configuration to measure, e.g. a Blur in directional mode with radius 5.
+struct BenchmarkCase {
+    std::string name;  // "Blur/directional/r5"; what --filter matches against
+    std::string type;  // Node factory type
+    ParamMap params;
+};
+
+struct BenchmarkFormat {
+    int width;
+    int height;
+    int channels;
+    int depth;  // CV_8U or CV_32F
+};
+
+struct BenchmarkResult {
+    std::string name;
+    BenchmarkFormat format;
+    size_t iterations = 0;
+    double medianMs = 0;
+    double minMs = 0;
+    double megapixelsPerSecond = 0;  // From the median
+    std::string error;               // Empty on success
+};
+
+struct BenchmarkOptions {
+    std::vector<int> sizes;      // Indices into benchmarkSizes(); empty = all
+    std::vector<int> channels = {1, 3, 4};
+    std::vector<int> depths = {CV_8U, CV_32F};
+    std::string filter;          // Only cases whose name contains this
+    double minSeconds = 0.25;    // Per case and format, after one warm-up run
+    size_t minIterations = 3;
+    size_t maxIterations = 1000;
+};
+
+// Every node in every mode worth tracking separately.
+std::vector<BenchmarkCase> benchmarkCases();
+
+// 256x256 up to 8K UHD, with a label for each.
+std::vector<std::pair<std::string, cv::Size>> benchmarkSizes();
+
+// Uniform noise in the format's full value range ([0, 1] for float); `seed` keeps runs repeatable.
+cv::Mat makeBenchmarkImage(const BenchmarkFormat& format, uint64_t seed);
+
+// Runs one node directly (no graph) on `images`, one per input port in port order. Nodes that
+// reject the format produce a result with `error` set instead of stopping the run.
+BenchmarkResult runBenchmark(const BenchmarkCase& benchmark, const BenchmarkFormat& format,
+                             const std::vector<cv::Mat>& images, const BenchmarkOptions& options);
+
+// Runs a tileable node on the whole of `images` and again tile by tile, each tile on views
+// grown by Node::getRequiredInputRect() as NodeGraph::runTiled() does, and compares the two.
+// Returns an empty string when every tile matches, otherwise what differs; nodes that are not
+// tileable with the case's settings pass trivially.
+std::string verifyTiling(const BenchmarkCase& benchmark, const std::vector<cv::Mat>& images, int tileSize);
+
+void writeJson(const std::vector<BenchmarkResult>& results, std::ostream& out);
+void writeCsv(const std::vector<BenchmarkResult>& results, std::ostream& out);
@@ -0,0 +1,181 @@
+#include "Benchmark.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// Prints the command line this executable accepts
+static void printUsage() {
+    std::cerr << "Usage: bench [options]\n"
+              << "  --format json|csv    output format (default json)\n"
+              << "  --output <file>      write results here instead of stdout\n"
+              << "  --filter <text>      only cases whose name contains <text>, e.g. Blur/gaussian\n"
+              << "  --sizes <list>       comma-separated subset of 256,512,1K,2K,4K,8K (default all)\n"
+              << "  --channels <list>    comma-separated subset of 1,3,4 (default all)\n"
+              << "  --depths <list>      comma-separated subset of 8u,32f (default all)\n"
+              << "  --min-time <s>       measure each case for at least this long (default 0.25)\n"
+              << "  --threads <n>        OpenCV worker threads, 0 runs single-threaded (default: OpenCV's choice)\n"
+              << "  --list               print the case names and exit\n"
+              << "  --verify-tiling      check that tileable cases give the same pixels tile by tile, then exit\n";
+}
+
+static std::vector<std::string> splitList(const std::string& text) {
+    std::vector<std::string> items;
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+int main(int argc, char** argv) {
+    BenchmarkOptions options;
+    std::string format = "json";
+    std::string outputPath;
+    int threads = -1;
+    bool verify = false;
+
+    const auto sizes = benchmarkSizes();
+    for (int i = 1; i < argc; ++i) {
+        std::string flag = argv[i];
+        if (flag == "--list") {
+            for (const auto& benchmark : benchmarkCases()) {
+                std::cout << benchmark.name << "\n";
+            }
+            return 0;
+        }
+        if (flag == "--verify-tiling") {
+            verify = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << flag << std::endl;
+            printUsage();
+            return 2;
+        }
+        std::string value = argv[++i];
+        if (flag == "--format" && (value == "json" || value == "csv")) {
+            format = value;
+        } else if (flag == "--output") {
+            outputPath = value;
+        } else if (flag == "--filter") {
+            options.filter = value;
+        } else if (flag == "--sizes") {
+            for (const auto& label : splitList(value)) {
+                auto found = std::find_if(sizes.begin(), sizes.end(), [&](const auto& size) { return size.first == label; });
+                if (found == sizes.end()) {
+                    std::cerr << "Unknown size " << label << std::endl;
+                    return 2;
+                }
+                options.sizes.push_back(static_cast<int>(found - sizes.begin()));
+            }
+        } else if (flag == "--channels") {
+            options.channels.clear();
+            for (const auto& item : splitList(value)) {
+                options.channels.push_back(std::atoi(item.c_str()));
+            }
+        } else if (flag == "--depths") {
+            options.depths.clear();
+            for (const auto& item : splitList(value)) {
+                if (item == "8u") {
+                    options.depths.push_back(CV_8U);
+                } else if (item == "32f") {
+                    options.depths.push_back(CV_32F);
+                } else {
+                    std::cerr << "Unknown depth " << item << std::endl;
+                    return 2;
+                }
+            }
+        } else if (flag == "--min-time") {
+            options.minSeconds = std::strtod(value.c_str(), nullptr);
+        } else if (flag == "--threads") {
+            threads = std::atoi(value.c_str());
+        } else {
+            std::cerr << "Unknown option " << flag << " " << value << std::endl;
+            printUsage();
+            return 2;
+        }
+    }
+
+    if (threads >= 0) {
+        cv::setNumThreads(threads);
+    }
+    if (options.sizes.empty()) {
+        for (size_t i = 0; i < sizes.size(); ++i) {
+            options.sizes.push_back(static_cast<int>(i));
+        }
+    }
+
+    std::vector<BenchmarkCase> cases;
+    for (const auto& benchmark : benchmarkCases()) {
+        if (benchmark.name.find(options.filter) != std::string::npos) {
+            cases.push_back(benchmark);
+        }
+    }
+
+    if (verify) {
+        // An odd frame size, so the last row and column of tiles are partial
+        int failures = 0;
+        for (int depth : options.depths) {
+            for (int channels : options.channels) {
+                BenchmarkFormat imageFormat{300, 200, channels, depth};
+                std::vector<cv::Mat> images = {makeBenchmarkImage(imageFormat, 1), makeBenchmarkImage(imageFormat, 2)};
+                for (const auto& benchmark : cases) {
+                    std::string error = verifyTiling(benchmark, images, 64);
+                    if (!error.empty()) {
+                        std::cerr << benchmark.name << " " << channels << "ch " << (depth == CV_8U ? "8u" : "32f")
+                                  << ": " << error << "\n";
+                        ++failures;
+                    }
+                }
+            }
+        }
+        std::cerr << (failures ? std::to_string(failures) + " tiling mismatches" : std::string("Tiling verified")) << std::endl;
+        return failures ? 1 : 0;
+    }
+
+    // Format-major, so each set of input images is generated once and shared by every case
+    std::vector<BenchmarkResult> results;
+    for (int sizeIndex : options.sizes) {
+        for (int depth : options.depths) {
+            for (int channels : options.channels) {
+                const cv::Size size = sizes[sizeIndex].second;
+                BenchmarkFormat imageFormat{size.width, size.height, channels, depth};
+                std::vector<cv::Mat> images = {makeBenchmarkImage(imageFormat, 1), makeBenchmarkImage(imageFormat, 2)};
+
+                for (const auto& benchmark : cases) {
+                    BenchmarkResult result = runBenchmark(benchmark, imageFormat, images, options);
+                    std::cerr << benchmark.name << " " << sizes[sizeIndex].first << " " << channels << "ch "
+                              << (depth == CV_8U ? "8u" : "32f") << ": ";
+                    if (result.error.empty()) {
+                        std::cerr << result.megapixelsPerSecond << " MP/s\n";
+                    } else {
+                        std::cerr << result.error << "\n";
+                    }
+                    results.push_back(result);
+                }
+            }
+        }
+    }
+
+    std::ofstream file;
+    if (!outputPath.empty()) {
+        file.open(outputPath);
+        if (!file) {
+            std::cerr << "Failed to write results: " << outputPath << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = outputPath.empty() ? std::cout : file;
+    if (format == "csv") {
+        writeCsv(results, out);
+    } else {
+        writeJson(results, out);
+    }
+    return 0;
+}
@@ -0,0 +1,149 @@
+#include "BufferPool.hpp"
+#include "Profiler.hpp"
+
+namespace {
+// Small buffers are cheap to malloc and would only fragment the buckets.
+const size_t minPooledBytes = 64 * 1024;
+const size_t pageBytes = 4096;
+}
+
+BufferPool::Handle BufferPool::create() {
+    return Handle(new BufferPool());
+}
+
+void BufferPool::retire() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        retired = true;
+    }
+    trim();
+}
+
+size_t BufferPool::bucketSize(size_t bytes) {
+    return (bytes + pageBytes - 1) / pageBytes * pageBytes;
+}
+
+// Same layout rules as OpenCV's default allocator, only the buffer source differs.
+cv::UMatData* BufferPool::allocate(int dims, const int* sizes, int type, void* data0, size_t* step,
+                                   cv::AccessFlag, cv::UMatUsageFlags) const {
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; i--) {
+        if (step) {
+            if (data0 && step[i] != CV_AUTOSTEP) {
+                CV_Assert(total <= step[i]);
+                total = step[i];
+            } else {
+                step[i] = total;
+            }
+        }
+        total *= sizes[i];
+    }
+
+    uchar* data = data0 ? static_cast<uchar*>(data0) : takeBuffer(total);
+    cv::UMatData* u = new cv::UMatData(this);
+    u->data = u->origdata = data;
+    u->size = total;
+    if (data0) {
+        u->flags |= cv::UMatData::USER_ALLOCATED;
+    }
+    return u;
+}
+
+bool BufferPool::allocate(cv::UMatData* u, cv::AccessFlag, cv::UMatUsageFlags) const {
+    return u != nullptr;
+}
+
+void BufferPool::deallocate(cv::UMatData* u) const {
+    if (!u) {
+        return;
+    }
+    CV_Assert(u->urefcount == 0);
+    CV_Assert(u->refcount == 0);
+    if (!(u->flags & cv::UMatData::USER_ALLOCATED)) {
+        returnBuffer(u->origdata, u->size);
+        u->origdata = nullptr;
+    }
+    delete u;
+}
+
+uchar* BufferPool::takeBuffer(size_t bytes) const {
+    if (bytes < minPooledBytes) {
+        Profiler::countAllocation(bytes);
+        return static_cast<uchar*>(cv::fastMalloc(bytes));
+    }
+
+    size_t bucket = bucketSize(bytes);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = idle.find(bucket);
+        if (found != idle.end() && !found->second.empty()) {
+            uchar* buffer = found->second.back();
+            found->second.pop_back();
+            idleBytes -= bucket;
+            ++reuseCount;
+            Profiler::countPoolReuse();
+            return buffer;
+        }
+        ++allocationCount;
+    }
+    // The requested size, not the bucket, so the bytes match what the default allocator reports.
+    Profiler::countAllocation(bytes);
+    return static_cast<uchar*>(cv::fastMalloc(bucket));
+}
+
+void BufferPool::returnBuffer(uchar* buffer, size_t bytes) const {
+    if (bytes < minPooledBytes) {
+        cv::fastFree(buffer);
+        return;
+    }
+
+    size_t bucket = bucketSize(bytes);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!retired && idleBytes + bucket <= idleBudget) {
+            idle[bucket].push_back(buffer);
+            idleBytes += bucket;
+            return;
+        }
+    }
+    cv::fastFree(buffer);
+}
+
+void BufferPool::setIdleBudget(size_t bytes) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        idleBudget = bytes;
+    }
+    if (getIdleBytes() > bytes) {
+        trim();
+    }
+}
+
+void BufferPool::trim() {
+    std::map<size_t, std::vector<uchar*>> released;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        released.swap(idle);
+        idleBytes = 0;
+    }
+    for (auto& bucket : released) {
+        for (uchar* buffer : bucket.second) {
+            cv::fastFree(buffer);
+        }
+    }
+}
+
+size_t BufferPool::getIdleBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return idleBytes;
+}
+
+size_t BufferPool::getReuseCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return reuseCount;
+}
+
+size_t BufferPool::getAllocationCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return allocationCount;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// cv::MatAllocator that recycles large pixel buffers instead of returning them to the heap.
+// Freed buffers are kept in buckets keyed by their (page-rounded) byte size, so a buffer
+// released by one node serves the next allocation of the same footprint, whatever its
+// element type, without a malloc or fresh page faults.
+//
+// Each NodeGraph owns one and hands it to its nodes for their outputs; it is never installed
+// as OpenCV's default allocator. OpenCV keeps a pointer to the allocator in every buffer it
+// hands out (and in every Mat header sharing it), which may outlive the graph, so the owner
+// retires the pool rather than deleting it: idle buffers are freed, later releases go
+// straight back to the heap, and only the empty pool object itself is leaked.
+class BufferPool : public cv::MatAllocator {
+public:
+    struct Retire {
+        void operator()(BufferPool* pool) const { pool->retire(); }
+    };
+    using Handle = std::unique_ptr<BufferPool, Retire>;
+
+    static Handle create();
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override;
+    bool allocate(cv::UMatData* data, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const override;
+    void deallocate(cv::UMatData* data) const override;
+
+    // Upper bound on bytes kept idle in the pool; buffers beyond it are freed.
+    void setIdleBudget(size_t bytes);
+
+    // Frees every idle buffer.
+    void trim();
+
+    size_t getIdleBytes() const;
+    size_t getReuseCount() const;
+    size_t getAllocationCount() const;
+
+private:
+    BufferPool() = default;
+    ~BufferPool() = default;
+
+    void retire();
+
+    uchar* takeBuffer(size_t bytes) const;
+    void returnBuffer(uchar* buffer, size_t bytes) const;
+
+    static size_t bucketSize(size_t bytes);
+
+    mutable std::mutex mutex;
+    mutable std::map<size_t, std::vector<uchar*>> idle;  // Bucket size -> idle buffers
+    mutable size_t idleBytes = 0;
+    mutable size_t reuseCount = 0;
+    mutable size_t allocationCount = 0;
+    bool retired = false;
+    size_t idleBudget = size_t(512) << 20;
+};
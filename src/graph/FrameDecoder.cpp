@@ -0,0 +1,117 @@
+#include "FrameDecoder.hpp"
+
+FrameDecoder::FrameDecoder(const std::string& source, size_t capacity)
+    : capture(source), ring(capacity == 0 ? 1 : capacity) {
+    opened = capture.isOpened();
+    if (opened) {
+        frameRate = capture.get(cv::CAP_PROP_FPS);
+        frameCount = static_cast<long long>(capture.get(cv::CAP_PROP_FRAME_COUNT));
+        thread = std::thread([this] { decodeLoop(); });
+    }
+}
+
+FrameDecoder::~FrameDecoder() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    spaceFree.notify_all();
+    frameReady.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+bool FrameDecoder::read(long long index, cv::Mat& frame) {
+    if (!opened || index < 0) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        // Frames before `index` will not be asked for again
+        while (count > 0 && ring[head].index < index) {
+            ring[head].image.release();
+            head = (head + 1) % ring.size();
+            --count;
+            spaceFree.notify_one();
+        }
+
+        if (count > 0 && ring[head].index == index) {
+            frame = std::move(ring[head].image);
+            ring[head].image = cv::Mat();
+            head = (head + 1) % ring.size();
+            --count;
+            spaceFree.notify_one();
+            return true;
+        }
+
+        if (seekTarget < 0) {
+            bool behind = count > 0 || index < nextIndex;  // Already decoded and dropped
+            bool farAhead = index > nextIndex + static_cast<long long>(ring.size());
+            if (behind || (farAhead && !finished)) {
+                requestSeek(index);
+            } else if (finished) {
+                return false;
+            }
+        }
+        frameReady.wait(lock);
+    }
+    return false;
+}
+
+// Called with the mutex held
+void FrameDecoder::requestSeek(long long index) {
+    for (size_t i = 0; i < count; ++i) {
+        ring[(head + i) % ring.size()].image.release();
+    }
+    head = 0;
+    count = 0;
+    seekTarget = index;
+    finished = false;
+    spaceFree.notify_one();
+}
+
+void FrameDecoder::decodeLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        spaceFree.wait(lock, [&] { return stopping || seekTarget >= 0 || (!finished && count < ring.size()); });
+        if (stopping) {
+            return;
+        }
+
+        if (seekTarget >= 0) {
+            long long target = seekTarget;
+            seekTarget = -1;
+            lock.unlock();
+            bool sought = capture.set(cv::CAP_PROP_POS_FRAMES, static_cast<double>(target));
+            lock.lock();
+            nextIndex = target;
+            if (!sought) {
+                finished = true;  // Readers waiting for `target` give up instead of hanging
+                frameReady.notify_all();
+            }
+            continue;
+        }
+
+        long long index = nextIndex;
+        lock.unlock();
+        cv::Mat image;
+        bool decoded = capture.read(image) && !image.empty();
+        lock.lock();
+
+        if (seekTarget >= 0) {
+            continue;  // A seek arrived meanwhile; this frame belongs to the old position
+        }
+        if (!decoded) {
+            finished = true;
+        } else {
+            Slot& slot = ring[(head + count) % ring.size()];
+            slot.index = index;
+            slot.image = image;
+            ++count;
+            ++nextIndex;
+        }
+        frameReady.notify_all();
+    }
+}
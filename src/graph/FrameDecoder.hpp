@@ -0,0 +1,61 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// Decodes a video file or an image sequence (a printf-style pattern such as
+// "shots/frame_%04d.png") on a background thread, into a ring of at most `capacity` frames.
+// While the graph evaluates frame N the thread is already decoding N+1, N+2, ...; a full
+// ring stalls it, so memory stays bounded however slow the consumer is.
+//
+// read() is cheap for the next frames in order. Any other index (a step back, or a jump
+// further than the ring reaches) discards the ring and restarts decoding there.
+class FrameDecoder {
+public:
+    FrameDecoder(const std::string& source, size_t capacity);
+    ~FrameDecoder();
+
+    FrameDecoder(const FrameDecoder&) = delete;
+    FrameDecoder& operator=(const FrameDecoder&) = delete;
+
+    bool isOpened() const { return opened; }
+
+    // As reported by the container; 0 or -1 when it does not know (e.g. some sequences).
+    double getFrameRate() const { return frameRate; }
+    long long getFrameCount() const { return frameCount; }
+
+    // Blocks until frame `index` is decoded and moves it into `frame`. Returns false past the
+    // end of the stream or when the frame cannot be decoded. Safe to call from several threads.
+    bool read(long long index, cv::Mat& frame);
+
+private:
+    struct Slot {
+        long long index = -1;
+        cv::Mat image;
+    };
+
+    void decodeLoop();
+    void requestSeek(long long index);
+
+    cv::VideoCapture capture;  // Only touched by the decoder thread after construction
+    bool opened = false;
+    double frameRate = 0;
+    long long frameCount = -1;
+
+    std::vector<Slot> ring;
+    size_t head = 0;            // Oldest decoded frame
+    size_t count = 0;           // Decoded frames waiting in the ring
+    long long nextIndex = 0;    // Frame the decoder thread produces next
+    long long seekTarget = -1;  // Pending restart position, -1 for none
+    bool finished = false;      // The decoder reached the end of the stream
+    bool stopping = false;
+
+    std::mutex mutex;
+    std::condition_variable frameReady;
+    std::condition_variable spaceFree;
+    std::thread thread;
+};
@@ -0,0 +1,454 @@
+#include "GraphFile.hpp"
+#include "Log.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <unordered_map>
+
+namespace {
+
+const char binaryMagic[4] = {'N', 'G', 'R', 'B'};
+const uint32_t binaryVersion = 1;
+
+// Refuse absurd sizes from corrupt files before allocating for them.
+const uint32_t maxStringBytes = 1u << 20;
+const uint32_t maxCount = 1u << 20;
+const uint64_t maxMatBytes = uint64_t(1) << 32;  // Only checked when the stream cannot tell its length
+
+class BinaryWriter {
+public:
+    explicit BinaryWriter(std::ostream& out) : out(out) {}
+
+    void bytes(const void* data, size_t size) { out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size)); }
+    void u32(uint32_t value) { bytes(&value, sizeof(value)); }
+    void i32(int32_t value) { bytes(&value, sizeof(value)); }
+    void u64(uint64_t value) { bytes(&value, sizeof(value)); }
+    void str(const std::string& value) {
+        u32(static_cast<uint32_t>(value.size()));
+        bytes(value.data(), value.size());
+    }
+
+    // Header and pixels; views into larger images are written row by row.
+    void mat(const cv::Mat& value) {
+        i32(value.rows);
+        i32(value.cols);
+        i32(value.type());
+        size_t rowBytes = value.cols * value.elemSize();
+        u64(static_cast<uint64_t>(rowBytes * value.rows));
+        if (value.isContinuous()) {
+            bytes(value.data, rowBytes * value.rows);
+        } else {
+            for (int y = 0; y < value.rows; ++y) {
+                bytes(value.ptr(y), rowBytes);
+            }
+        }
+    }
+
+private:
+    std::ostream& out;
+};
+
+// Every read checks the stream; after the first failure `ok` stays false and values are zero.
+class BinaryReader {
+public:
+    explicit BinaryReader(std::istream& in) : in(in) {}
+
+    bool ok = true;
+
+    void bytes(void* data, size_t size) {
+        if (ok && !in.read(static_cast<char*>(data), static_cast<std::streamsize>(size))) {
+            ok = false;
+        }
+    }
+    uint32_t u32() { uint32_t value = 0; bytes(&value, sizeof(value)); return ok ? value : 0; }
+    int32_t i32() { int32_t value = 0; bytes(&value, sizeof(value)); return ok ? value : 0; }
+    uint64_t u64() { uint64_t value = 0; bytes(&value, sizeof(value)); return ok ? value : 0; }
+    uint32_t count() {
+        uint32_t value = u32();
+        ok = ok && value <= maxCount;
+        return ok ? value : 0;
+    }
+    std::string str() {
+        uint32_t size = u32();
+        ok = ok && size <= maxStringBytes;
+        std::string value(ok ? size : 0, '\0');
+        bytes(&value[0], value.size());
+        return value;
+    }
+
+    // Reads the pixels straight into the new Mat's buffer.
+    cv::Mat mat() {
+        int rows = i32();
+        int cols = i32();
+        int type = i32();
+        uint64_t size = u64();
+        // rows * cols is checked on its own first, so the product with the element size cannot wrap
+        ok = ok && size <= remaining() && rows >= 0 && cols >= 0 && CV_MAT_DEPTH(type) <= CV_64F &&
+             CV_MAT_CN(type) <= 4 && static_cast<uint64_t>(rows) * cols <= size &&
+             size == static_cast<uint64_t>(rows) * cols * CV_ELEM_SIZE(type);
+        if (!ok || rows == 0 || cols == 0) {
+            return cv::Mat();
+        }
+        cv::Mat value(rows, cols, type);
+        bytes(value.data, size);
+        return ok ? value : cv::Mat();
+    }
+
+private:
+    // Bytes left in the stream, or maxMatBytes if it cannot seek.
+    uint64_t remaining() {
+        if (!ok) {
+            return 0;
+        }
+        std::streampos here = in.tellg();
+        if (here == std::streampos(-1) || !in.seekg(0, std::ios::end)) {
+            in.clear();
+            return maxMatBytes;
+        }
+        std::streampos end = in.tellg();
+        in.seekg(here);
+        return end >= here ? static_cast<uint64_t>(end - here) : 0;
+    }
+
+    std::istream& in;
+};
+
+std::string quote(const std::string& token) {
+    bool plain = !token.empty() && token.find_first_of(" \t\"\\#") == std::string::npos;
+    if (plain) {
+        return token;
+    }
+    std::string quoted = "\"";
+    for (char c : token) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+// Splits a line into whitespace-separated tokens, removing quotes and escapes.
+// Stops at an unquoted '#'. Returns false on an unterminated quote.
+bool tokenize(const std::string& line, std::vector<std::string>& tokens) {
+    tokens.clear();
+    std::string token;
+    bool inToken = false;
+    bool quoted = false;
+    for (size_t i = 0; i < line.size(); ++i) {
+        char c = line[i];
+        if (quoted) {
+            if (c == '\\' && i + 1 < line.size()) {
+                token += line[++i];
+            } else if (c == '"') {
+                quoted = false;
+            } else {
+                token += c;
+            }
+        } else if (c == '"') {
+            quoted = inToken = true;
+        } else if (c == '#') {
+            break;
+        } else if (c == ' ' || c == '\t' || c == '\r') {
+            if (inToken) {
+                tokens.push_back(token);
+                token.clear();
+                inToken = false;
+            }
+        } else {
+            token += c;
+            inToken = true;
+        }
+    }
+    if (inToken) {
+        tokens.push_back(token);
+    }
+    return !quoted;
+}
+
+}
+
+bool saveGraph(const NodeGraph& graph, const std::string& path) {
+    std::set<std::string> names;
+    for (const auto& node : graph.getNodes()) {
+        if (node->getType().empty()) {
+            LOG_ERROR("GraphFile", "cannot save, node has no type node=" << node->name);
+            return false;
+        }
+        if (!names.insert(node->name).second) {
+            LOG_ERROR("GraphFile", "cannot save, node name used twice node=" << node->name);
+            return false;
+        }
+    }
+
+    std::ofstream file(path);
+    if (!file) {
+        LOG_ERROR("GraphFile", "write failed path=" << path);
+        return false;
+    }
+
+    file << "# node graph\n";
+    for (const auto& node : graph.getNodes()) {
+        file << "node " << quote(node->getType()) << ' ' << quote(node->name);
+        for (const auto& param : node->getParams()) {
+            file << ' ' << quote(param.first + "=" + param.second);
+        }
+        file << '\n';
+    }
+    for (const auto& connection : graph.getConnections()) {
+        file << "connect " << quote(connection.from->name) << ' ' << quote(connection.fromPort) << ' '
+             << quote(connection.to->name) << ' ' << quote(connection.toPort) << '\n';
+    }
+    return static_cast<bool>(file);
+}
+
+bool saveGraphBinary(const NodeGraph& graph, const std::string& path, bool embedResults) {
+    const auto& nodes = graph.getNodes();
+    std::unordered_map<const Node*, uint32_t> indexOf;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (nodes[i]->getType().empty()) {
+            LOG_ERROR("GraphFile", "cannot save, node has no type node=" << nodes[i]->name);
+            return false;
+        }
+        indexOf[nodes[i].get()] = static_cast<uint32_t>(i);
+    }
+
+    std::vector<OutputCache::Key> keys;
+    if (embedResults) {
+        keys = graph.computeContentKeys();
+        if (keys.empty() && !nodes.empty()) {
+            LOG_ERROR("GraphFile", "cannot embed results, the graph contains a cycle path=" << path);
+            return false;
+        }
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        LOG_ERROR("GraphFile", "write failed path=" << path);
+        return false;
+    }
+
+    BinaryWriter out(file);
+    out.bytes(binaryMagic, sizeof(binaryMagic));
+    out.u32(binaryVersion);
+
+    out.u32(static_cast<uint32_t>(nodes.size()));
+    for (const auto& node : nodes) {
+        out.str(node->getType());
+        out.str(node->name);
+        ParamMap params = node->getParams();
+        out.u32(static_cast<uint32_t>(params.size()));
+        for (const auto& param : params) {
+            out.str(param.first);
+            out.str(param.second);
+        }
+    }
+
+    const auto& connections = graph.getConnections();
+    out.u32(static_cast<uint32_t>(connections.size()));
+    for (const auto& connection : connections) {
+        out.u32(indexOf.at(connection.from.get()));
+        out.str(connection.fromPort);
+        out.u32(indexOf.at(connection.to.get()));
+        out.str(connection.toPort);
+    }
+
+    // Only up-to-date outputs are worth keeping: a dirty node's output no longer matches its key.
+    std::vector<std::pair<OutputCache::Key, OutputCache::Entry>> results;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (nodes[i]->isDirty()) {
+            continue;
+        }
+        OutputCache::Entry entry;
+        for (const auto& port : nodes[i]->getOutputPorts()) {
+            cv::Mat value = graph.getNodeOutput(nodes[i], port.name);
+            if (!value.empty() && value.dims == 2) {
+                entry[port.name] = value;
+            }
+        }
+        if (!entry.empty()) {
+            results.emplace_back(keys[i], std::move(entry));
+        }
+    }
+
+    out.u32(static_cast<uint32_t>(results.size()));
+    for (const auto& result : results) {
+        out.u64(result.first);
+        out.u32(static_cast<uint32_t>(result.second.size()));
+        for (const auto& port : result.second) {
+            out.str(port.first);
+            out.mat(port.second);
+        }
+    }
+    return static_cast<bool>(file);
+}
+
+// Body of a binary graph file, after the magic bytes.
+static bool loadGraphBinary(const std::string& path, std::istream& file, NodeGraph& graph, const NodeCreator& create) {
+    BinaryReader in(file);
+    auto fail = [&](const std::string& message) {
+        LOG_ERROR("GraphFile", message << " path=" << path);
+        graph.clear();
+        return false;
+    };
+
+    uint32_t version = in.u32();
+    if (version != binaryVersion) {
+        return fail("unsupported binary graph version " + std::to_string(version));
+    }
+
+    std::vector<std::shared_ptr<Node>> nodes;
+    uint32_t nodeCount = in.count();
+    for (uint32_t i = 0; i < nodeCount && in.ok; ++i) {
+        std::string type = in.str();
+        std::string name = in.str();
+        ParamMap params;
+        uint32_t paramCount = in.count();
+        for (uint32_t p = 0; p < paramCount && in.ok; ++p) {
+            std::string key = in.str();
+            params[key] = in.str();
+        }
+        if (!in.ok) {
+            break;
+        }
+
+        auto node = create(type, name);
+        if (!node) {
+            return fail("unknown node type " + type);
+        }
+        node->applyParams(params);
+        nodes.push_back(node);
+        graph.addNode(node);
+    }
+
+    uint32_t connectionCount = in.count();
+    for (uint32_t c = 0; c < connectionCount && in.ok; ++c) {
+        uint32_t from = in.u32();
+        std::string fromPort = in.str();
+        uint32_t to = in.u32();
+        std::string toPort = in.str();
+        if (!in.ok) {
+            break;
+        }
+        if (from >= nodes.size() || to >= nodes.size()) {
+            return fail("connection refers to an unknown node");
+        }
+        size_t before = graph.getConnections().size();
+        graph.connectNodes(nodes[from], fromPort, nodes[to], toPort);
+        if (graph.getConnections().size() == before) {
+            return fail("invalid connection");  // connectNodes() printed why
+        }
+    }
+
+    std::vector<std::pair<OutputCache::Key, OutputCache::Entry>> results;
+    size_t resultBytes = 0;
+    uint32_t resultCount = in.count();
+    for (uint32_t r = 0; r < resultCount && in.ok; ++r) {
+        OutputCache::Key key = in.u64();
+        OutputCache::Entry entry;
+        uint32_t portCount = in.count();
+        for (uint32_t p = 0; p < portCount && in.ok; ++p) {
+            std::string port = in.str();
+            cv::Mat value = in.mat();
+            resultBytes += value.total() * value.elemSize();
+            entry[port] = value;
+        }
+        results.emplace_back(key, std::move(entry));
+    }
+    if (!in.ok) {
+        return fail("truncated or corrupt binary graph");
+    }
+
+    if (!results.empty()) {
+        OutputCache& cache = graph.getCache();
+        if (cache.getBudget() < resultBytes) {
+            LOG_INFO("GraphFile", "enabling the output cache for embedded results count=" << results.size());
+            cache.setBudget(std::max<size_t>(resultBytes * 2, size_t(256) << 20));
+        }
+        for (const auto& result : results) {
+            cache.insert(result.first, result.second);
+        }
+    }
+    return true;
+}
+
+bool loadGraph(const std::string& path, NodeGraph& graph, const NodeCreator& create) {
+    graph.clear();
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        LOG_ERROR("GraphFile", "open failed path=" << path);
+        return false;
+    }
+
+    char magic[sizeof(binaryMagic)] = {};
+    file.read(magic, sizeof(magic));
+    if (file && std::memcmp(magic, binaryMagic, sizeof(magic)) == 0) {
+        return loadGraphBinary(path, file, graph, create);
+    }
+    file.clear();
+    file.seekg(0);
+
+    std::unordered_map<std::string, std::shared_ptr<Node>> byName;
+    std::string line;
+    std::vector<std::string> tokens;
+    for (int lineNumber = 1; std::getline(file, line); ++lineNumber) {
+        auto fail = [&](const std::string& message) {
+            LOG_ERROR("GraphFile", message << " path=" << path << " line=" << lineNumber);
+            graph.clear();
+            return false;
+        };
+
+        if (!tokenize(line, tokens)) {
+            return fail("unterminated quote");
+        }
+        if (tokens.empty()) {
+            continue;
+        }
+
+        if (tokens[0] == "node") {
+            if (tokens.size() < 3) {
+                return fail("expected: node <type> <name> [key=value ...]");
+            }
+            if (byName.count(tokens[2])) {
+                return fail("duplicate node name " + tokens[2]);
+            }
+            auto node = create(tokens[1], tokens[2]);
+            if (!node) {
+                return fail("unknown node type " + tokens[1]);
+            }
+
+            ParamMap params;
+            for (size_t i = 3; i < tokens.size(); ++i) {
+                size_t equals = tokens[i].find('=');
+                if (equals == std::string::npos || equals == 0) {
+                    return fail("expected key=value, got " + tokens[i]);
+                }
+                params[tokens[i].substr(0, equals)] = tokens[i].substr(equals + 1);
+            }
+            node->applyParams(params);
+
+            byName[tokens[2]] = node;
+            graph.addNode(node);
+        } else if (tokens[0] == "connect") {
+            if (tokens.size() != 5) {
+                return fail("expected: connect <from> <fromPort> <to> <toPort>");
+            }
+            auto from = byName.find(tokens[1]);
+            auto to = byName.find(tokens[3]);
+            if (from == byName.end() || to == byName.end()) {
+                return fail("connection refers to an unknown node");
+            }
+            size_t before = graph.getConnections().size();
+            graph.connectNodes(from->second, tokens[2], to->second, tokens[4]);
+            if (graph.getConnections().size() == before) {
+                return fail("invalid connection");  // connectNodes() printed why
+            }
+        } else {
+            return fail("unknown statement " + tokens[0]);
+        }
+    }
+    return true;
+}
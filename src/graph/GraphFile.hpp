@@ -0,0 +1,34 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <string>
+#include "NodeGraph.hpp"
+
+// Text graph files, one statement per line:
+//
+//   # comment
+//   node <type> <name> [key=value ...]
+//   connect <from> <fromPort> <to> <toPort>
+//
+// Types are Node::getType() names and key=value pairs are Node::getParams(). Tokens with
+// spaces, quotes or '#' are double-quoted with backslash escapes. Node names must be unique.
+
+// Makes a default node of the given type, or nullptr if the type is unknown (see createNode()).
+using NodeCreator = std::function<std::shared_ptr<Node>(const std::string& type, const std::string& name)>;
+
+// Fails if a node has no type or two nodes share a name.
+bool saveGraph(const NodeGraph& graph, const std::string& path);
+
+// Replaces the graph's nodes and connections with the file's, text or binary (detected from
+// the first bytes). On error the graph is left empty.
+bool loadGraph(const std::string& path, NodeGraph& graph, const NodeCreator& create);
+
+// Binary graph files hold the same nodes, params and connections as text ones, as
+// length-prefixed fields in native byte order, so loading is a handful of reads.
+//
+// With `embedResults`, the outputs of every node that is up to date are stored too, under
+// the content key NodeGraph's cache would use for them. Loading puts them back into the
+// cache (enabling it if needed), so the next run() fetches instead of recomputing. Because
+// keys cover parameters, upstream keys and e.g. input file timestamps, a result is only
+// reused if it is still valid; anything else is recomputed as usual.
+bool saveGraphBinary(const NodeGraph& graph, const std::string& path, bool embedResults = false);
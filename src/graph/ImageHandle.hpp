@@ -0,0 +1,39 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+
+// How nodes hold the images they are given. Copies of a handle (and the cv::Mat it was made
+// from) share pixels; the first write() through a handle whose buffer is also referenced
+// elsewhere detaches it with a deep copy, so a node that modifies an input never corrupts the
+// buffer its upstream node, the cache or a sibling branch is still reading. This holds only as
+// long as nodes write through write(): the Mat from read() is const, but cv::Mat constness does
+// not extend to its pixels, so writing through it is a bug the compiler will not catch.
+class ImageHandle {
+public:
+    ImageHandle() = default;
+    ImageHandle(const cv::Mat& image) : image(image) {}
+
+    const cv::Mat& read() const { return image; }
+
+    // Mutable access, copying first unless this handle is the buffer's only owner.
+    cv::Mat& write() {
+        if (isShared()) {
+            image = image.clone();
+        }
+        return image;
+    }
+
+    // True when someone else may see writes: another header holds the buffer, or the Mat
+    // wraps memory OpenCV does not own.
+    bool isShared() const {
+        if (image.empty()) {
+            return false;
+        }
+        return !image.u || CV_XADD(&image.u->refcount, 0) > 1;
+    }
+
+    bool empty() const { return image.empty(); }
+    void release() { image.release(); }
+
+private:
+    cv::Mat image;
+};
@@ -0,0 +1,61 @@
+#include "Log.hpp"
+#include <atomic>
+#include <iostream>
+#include <map>
+#include <mutex>
+
+namespace {
+
+std::atomic<int> defaultLevel{static_cast<int>(LogLevel::Info)};
+std::atomic<bool> haveCategoryLevels{false};  // Keeps the common case free of the lock
+std::mutex logMutex;
+
+std::map<std::string, LogLevel>& categoryLevels() {
+    static std::map<std::string, LogLevel> levels;
+    return levels;
+}
+
+const char* levelName(LogLevel level) {
+    switch (level) {
+    case LogLevel::Trace: return "trace";
+    case LogLevel::Debug: return "debug";
+    case LogLevel::Info: return "info";
+    case LogLevel::Warn: return "warn";
+    case LogLevel::Error: return "error";
+    default: return "";
+    }
+}
+
+}
+
+void setLogLevel(LogLevel level) {
+    defaultLevel = static_cast<int>(level);
+}
+
+void setLogLevel(const std::string& category, LogLevel level) {
+    std::lock_guard<std::mutex> lock(logMutex);
+    categoryLevels()[category] = level;
+    haveCategoryLevels = true;
+}
+
+bool logEnabled(LogLevel level, const char* category) {
+    if (level == LogLevel::Off) {
+        return false;
+    }
+    if (haveCategoryLevels) {
+        std::lock_guard<std::mutex> lock(logMutex);
+        auto found = categoryLevels().find(category);
+        if (found != categoryLevels().end()) {
+            return level >= found->second;
+        }
+    }
+    return static_cast<int>(level) >= defaultLevel;
+}
+
+void writeLog(LogLevel level, const char* category, const std::string& message) {
+    std::lock_guard<std::mutex> lock(logMutex);
+    std::clog << levelName(level) << " " << category << ": " << message << '\n';
+    if (level >= LogLevel::Error) {
+        std::clog.flush();
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <sstream>
+#include <string>
+
+// Leveled logging with one category per node type ("Blur", "Threshold", ...) or subsystem
+// ("Graph"). Messages are written as one line, "<level> <category>: <text>", to std::clog,
+// which is buffered: only errors flush. Fields in the text are written as key=value so
+// lines stay greppable, e.g.
+//
+//     LOG_DEBUG("Blur", "applied node=" << name << " radius=" << radius);
+//
+// Statements below NODEGRAPH_LOG_LEVEL are removed by the preprocessor, arguments included,
+// so trace and debug logging in process() and renderUI() costs nothing in normal builds.
+// Above it, setLogLevel() filters further at run time, before the message is formatted.
+
+#define NODEGRAPH_LOG_TRACE 0
+#define NODEGRAPH_LOG_DEBUG 1
+#define NODEGRAPH_LOG_INFO 2
+#define NODEGRAPH_LOG_WARN 3
+#define NODEGRAPH_LOG_ERROR 4
+#define NODEGRAPH_LOG_OFF 5
+
+#ifndef NODEGRAPH_LOG_LEVEL
+#define NODEGRAPH_LOG_LEVEL NODEGRAPH_LOG_INFO
+#endif
+
+enum class LogLevel { Trace, Debug, Info, Warn, Error, Off };
+
+// Run-time minimum level, for every category without a level of its own. Defaults to Info.
+void setLogLevel(LogLevel level);
+
+// Run-time minimum level for one category, e.g. setLogLevel("Blur", LogLevel::Debug).
+void setLogLevel(const std::string& category, LogLevel level);
+
+// Whether a message at `level` in `category` would currently be written.
+bool logEnabled(LogLevel level, const char* category);
+
+// Writes one line. Safe to call from several threads; lines are never interleaved.
+void writeLog(LogLevel level, const char* category, const std::string& message);
+
+#define NODEGRAPH_LOG(level, category, message)                      \
+    do {                                                             \
+        if (logEnabled(level, category)) {                           \
+            std::ostringstream nodegraphLogStream;                   \
+            nodegraphLogStream << message;                           \
+            writeLog(level, category, nodegraphLogStream.str());     \
+        }                                                            \
+    } while (0)
+
+#define NODEGRAPH_LOG_DISCARD() \
+    do {                        \
+    } while (0)
+
+#if NODEGRAPH_LOG_LEVEL <= NODEGRAPH_LOG_TRACE
+#define LOG_TRACE(category, message) NODEGRAPH_LOG(LogLevel::Trace, category, message)
+#else
+#define LOG_TRACE(category, message) NODEGRAPH_LOG_DISCARD()
+#endif
+
+#if NODEGRAPH_LOG_LEVEL <= NODEGRAPH_LOG_DEBUG
+#define LOG_DEBUG(category, message) NODEGRAPH_LOG(LogLevel::Debug, category, message)
+#else
+#define LOG_DEBUG(category, message) NODEGRAPH_LOG_DISCARD()
+#endif
+
+#if NODEGRAPH_LOG_LEVEL <= NODEGRAPH_LOG_INFO
+#define LOG_INFO(category, message) NODEGRAPH_LOG(LogLevel::Info, category, message)
+#else
+#define LOG_INFO(category, message) NODEGRAPH_LOG_DISCARD()
+#endif
+
+#if NODEGRAPH_LOG_LEVEL <= NODEGRAPH_LOG_WARN
+#define LOG_WARN(category, message) NODEGRAPH_LOG(LogLevel::Warn, category, message)
+#else
+#define LOG_WARN(category, message) NODEGRAPH_LOG_DISCARD()
+#endif
+
+#if NODEGRAPH_LOG_LEVEL <= NODEGRAPH_LOG_ERROR
+#define LOG_ERROR(category, message) NODEGRAPH_LOG(LogLevel::Error, category, message)
+#else
+#define LOG_ERROR(category, message) NODEGRAPH_LOG_DISCARD()
+#endif
@@ -1,21 +1,132 @@
 #pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <opencv2/opencv.hpp>
 #include <vector>
 #include <memory>
+#include "Params.hpp"
+#include "PointwiseOp.hpp"
 
 class Node {
 public:
     std::string id;     
     std::string name;  
 
+    // Ports are the named connection points NodeGraph wires together.
+    // A Mask is a single-channel image; an Image may have any number of channels.
+    enum class PortType { Image, Mask };
+    struct Port {
+        std::string name;
+        PortType type;
+    };
+
     virtual void process() = 0;  
     virtual void renderUI() = 0;  
     virtual cv::Mat getOutput() const = 0;  
-    virtual void setInput(const cv::Mat& input) { this->input = input; }  
+    virtual void setInput(const cv::Mat& input) { this->input = input; markDirty(); }  
 
     cv::Mat getInput() const { return input; }
 
+    // Single-port nodes expose "input" and "output"; multi-port nodes override these.
+    // Port values are cv::Mat headers, so passing them along never copies pixel data.
+    virtual std::vector<Port> getInputPorts() const { return {{"input", PortType::Image}}; }
+    virtual std::vector<Port> getOutputPorts() const { return {{"output", PortType::Image}}; }
+    virtual void setInputPort(const std::string& port, const cv::Mat& value) { setInput(value); }
+    virtual cv::Mat getOutputPort(const std::string& port) const { return getOutput(); }
+
+    // Tiled execution: a tileable node produces the same pixels whether it runs on the whole
+    // frame or on any sub-rectangle of it, as long as it is given getHalo() extra pixels of
+    // context on every side. Nodes with global operations (histograms, normalisation, file I/O)
+    // keep the default and always see whole frames.
+    virtual bool isTileable() const { return false; }
+    virtual int getHalo() const { return 0; }
+
+    // Region of its inputs a tileable node needs to produce `outputRect` of its output, in frame
+    // coordinates; the graph clips it to the frame. The default grows the rect by getHalo(),
+    // which covers filters (radius, aperture) and passes the rect through for per-pixel nodes.
+    virtual cv::Rect getRequiredInputRect(const cv::Rect& outputRect) const {
+        int halo = getHalo();
+        return cv::Rect(outputRect.x - halo, outputRect.y - halo, outputRect.width + 2 * halo, outputRect.height + 2 * halo);
+    }
+
+    // Frame position of the inputs' top-left pixel while the graph evaluates a region (a tile
+    // or runRegion()), (0, 0) for whole frames. Nodes whose output depends on absolute
+    // position, like procedural noise, offset by it.
+    void setRegionOrigin(const cv::Point& origin) { regionOrigin = origin; }
+
+    // Per-pixel nodes whose 8-bit output depends only on the same pixel of their inputs can
+    // describe themselves as a lookup table; NodeGraph then fuses chains of them into one pass.
+    // Return false (the default) when the current settings are not per-pixel.
+    virtual bool getPointwiseOp(PointwiseOp& op) const { return false; }
+
+    // Every parameter that influences the output, used to key NodeGraph's output cache.
+    // Two nodes of the same type with equal params and equal inputs must produce equal outputs.
+    virtual ParamMap getParams() const { return {}; }
+
+    // Stable type name used by graph files and the node factory, e.g. "Blur".
+    virtual std::string getType() const { return std::string(); }
+
+    // Inverse of getParams(): applies every parameter present in `params` and marks the node
+    // dirty. Unknown keys and values that do not parse are ignored.
+    virtual void applyParams(const ParamMap& params) {}
+
+    // Independent copy of the node (settings, inputs, outputs and dirty flag) that a background
+    // evaluation can process while the original keeps being edited. Node types implement it
+    // with their copy constructor, so cloned Mats share pixel data rather than duplicating it;
+    // call releaseOutputs() on the copy before processing it. Nodes that return nullptr (the
+    // default) cannot be part of NodeGraph::runAsync().
+    virtual std::shared_ptr<Node> clone() const { return nullptr; }
+
+    // Interactive nodes may open preview windows, wait for key presses or write debug images.
+    // Headless runs (batch processing, servers) switch that off.
+    void setInteractive(bool enabled) { interactive = enabled; }
+    bool isInteractive() const { return interactive; }
+
+    // Preview mode: images reaching the node are `scale` times their full-resolution size.
+    // Sources produce the downscaled image; nodes with parameters measured in pixels (radii,
+    // block sizes, noise frequency) rescale them so the preview looks like the final render.
+    void setResolutionScale(double scale) {
+        if (scale != resolutionScale) {
+            resolutionScale = scale;
+            markDirty();
+        }
+    }
+    double getResolutionScale() const { return resolutionScale; }
+
+    // Sinks are the nodes whose results leave the graph (e.g. files written by OutputNode).
+    // With lazy evaluation, NodeGraph only evaluates what some sink depends on, and a sink's
+    // getOutput() pulls its upstream nodes up to date through the handler the graph installs.
+    virtual bool isSink() const { return false; }
+    void setPullHandler(std::function<void()> handler) { pullHandler = std::move(handler); }
+
+    // Allocator the node's output buffers come from, e.g. the graph's BufferPool; nullptr (the
+    // default) leaves them to OpenCV's default allocator.
+    void setOutputAllocator(cv::MatAllocator* allocator) { outputAllocator = allocator; }
+
+    // Drops the node's references to its output buffers, so the next process() allocates
+    // fresh ones instead of overwriting buffers the graph has handed out (e.g. to its cache or
+    // to the original of a clone). Nodes with outputs release every output Mat here; a cached
+    // copy is then never overwritten in place.
+    virtual void releaseOutputs() {}
+
+    // Drops the node's references to its input images. Called together with releaseOutputs()
+    // once every consumer of the node has run, so the buffers can be reused elsewhere.
+    virtual void releaseInputs() { input.release(); }
+
+    // A node is dirty when its output no longer matches its inputs and parameters.
+    // Setters mark the node dirty; NodeGraph::run() recomputes dirty nodes and
+    // everything downstream of them, then clears the flag.
+    void markDirty() { dirty = true; ++revision; }
+    void clearDirty() { dirty = false; }
+    bool isDirty() const { return dirty; }
+
+    // Incremented by every markDirty(), so a result computed from an earlier state of the node
+    // can be recognised as outdated.
+    uint64_t getRevision() const { return revision; }
+
     virtual ~Node() = default; 
 
 protected:
@@ -23,4 +134,24 @@ protected:
 
     enum class NodeType { Input, Processing, Output };
     NodeType nodeType; 
+
+    // A length of `pixels` at full resolution, measured at the current resolution scale.
+    int scaledPixels(int pixels, int minimum = 1) const {
+        return std::max(minimum, static_cast<int>(std::lround(pixels * resolutionScale)));
+    }
+
+    // Nodes call this on every output Mat before process() (re)creates it, so the new buffer
+    // comes from the output allocator. Buffers already allocated are unaffected.
+    void useOutputAllocator(cv::Mat& output) const { output.allocator = outputAllocator; }
+
+    // Sinks call this at the start of getOutput(); does nothing unless a lazy graph owns the node.
+    void pullUpstream() const { if (pullHandler) pullHandler(); }
+
+    bool dirty = true;  // Nothing has been computed yet
+    bool interactive = true;
+    uint64_t revision = 0;
+    double resolutionScale = 1.0;
+    cv::Point regionOrigin;
+    std::function<void()> pullHandler;
+    cv::MatAllocator* outputAllocator = nullptr;
 };
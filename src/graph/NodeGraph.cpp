@@ -1,44 +1,1335 @@
 #include "NodeGraph.hpp"
-#include <iostream>
+#include "BufferPool.hpp"
+#include "PointwiseChain.hpp"
+#include "Log.hpp"
 #include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+// Sets a flag for the lifetime of a scope, restoring its previous value afterwards.
+class ScopedFlag {
+public:
+    explicit ScopedFlag(bool& flag) : flag(flag), previous(flag) { flag = true; }
+    ~ScopedFlag() { flag = previous; }
+
+private:
+    bool& flag;
+    bool previous;
+};
+
+// Non-zero while getNodeOutput() reads on this thread: reading a sink's value must not pull it.
+thread_local int pullsSuppressed = 0;
+
+// OpenCV's thread count is process-wide, so it is lowered when the first graph creates a worker
+// pool and restored when the last such pool is gone, rather than around every parallel run.
+std::mutex cvThreadsMutex;
+int cvThreadsUsers = 0;
+int cvThreadsBefore = 0;
+
+// Gives OpenCV's internal parallel loops only one worker's share of the cores, otherwise every
+// node would try to use the whole machine at once.
+void shareCvThreads(size_t workers) {
+    std::lock_guard<std::mutex> lock(cvThreadsMutex);
+    if (cvThreadsUsers++ == 0) {
+        cvThreadsBefore = cv::getNumThreads();
+    }
+    unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+    cv::setNumThreads(static_cast<int>(std::max<size_t>(1, hardware / workers)));
+}
+
+void unshareCvThreads() {
+    std::lock_guard<std::mutex> lock(cvThreadsMutex);
+    if (--cvThreadsUsers == 0) {
+        cv::setNumThreads(cvThreadsBefore);
+    }
+}
+
+}
+
+struct NodeGraph::AsyncJob {
+    uint64_t generation = 0;
+    std::atomic<bool> cancelled{false};
+    std::unique_ptr<NodeGraph> snapshot;
+    std::function<void(const AsyncResult&)> onComplete;
+    std::promise<AsyncResult> promise;
+
+    // Indexed like the graph's nodes when the job started.
+    std::vector<std::shared_ptr<Node>> originals;
+    std::vector<uint64_t> revisions;
+    std::vector<NodeState> states;  // Filled in when the snapshot finished
+    std::vector<char> dirty;
+};
+
+NodeGraph::~NodeGraph() {
+    cancelAsync();
+    asyncPool.reset();  // Waits for the job in flight, which stops before its next node
+    clear();  // Nodes may outlive the graph; their pull handlers must not
+    resetPool();
+}
 
 void NodeGraph::addNode(const std::shared_ptr<Node>& node) {
+    node->setInteractive(interactive);
+    node->setResolutionScale(previewScale);
+    if (lazyEvaluation && node->isSink()) {
+        const Node* sink = node.get();
+        node->setPullHandler([this, sink] { pullNode(sink); });
+    }
     nodes.push_back(node);
 }
 
+void NodeGraph::setPreviewScale(double scale) {
+    previewScale = std::clamp(scale, 0.01, 1.0);
+    for (auto& node : nodes) {
+        node->setResolutionScale(previewScale);
+    }
+}
+
+void NodeGraph::renderFullResolution() {
+    for (auto& node : nodes) {
+        node->setResolutionScale(1.0);
+    }
+    run();
+    for (auto& node : nodes) {
+        node->setResolutionScale(previewScale);
+    }
+}
+
+void NodeGraph::setLazyEvaluation(bool enabled) {
+    lazyEvaluation = enabled;
+    for (auto& node : nodes) {
+        if (!node->isSink()) {
+            continue;
+        }
+        const Node* sink = node.get();
+        node->setPullHandler(enabled ? std::function<void()>([this, sink] { pullNode(sink); }) : nullptr);
+    }
+}
+
+void NodeGraph::setInteractive(bool enabled) {
+    interactive = enabled;
+    for (auto& node : nodes) {
+        node->setInteractive(enabled);
+    }
+}
+
 void NodeGraph::connectNodes(const std::shared_ptr<Node>& fromNode, const std::shared_ptr<Node>& toNode) {
-    if (std::find(nodes.begin(), nodes.end(), fromNode) != nodes.end() &&
-        std::find(nodes.begin(), nodes.end(), toNode) != nodes.end()) {
-        connections.push_back(std::make_pair(fromNode, toNode));
-    } else {
-        std::cerr << "Invalid node connection!" << std::endl;
+    if (!fromNode || !toNode) {
+        LOG_ERROR("Graph", "Invalid node connection!");
+        return;
+    }
+
+    auto outputs = fromNode->getOutputPorts();
+    auto inputs = toNode->getInputPorts();
+    if (outputs.empty() || inputs.empty()) {
+        LOG_ERROR("Graph", "Invalid node connection: " << fromNode->name << " -> " << toNode->name << " has no ports to connect!");
+        return;
+    }
+    connectNodes(fromNode, outputs.front().name, toNode, inputs.front().name);
+}
+
+void NodeGraph::connectNodes(const std::shared_ptr<Node>& fromNode, const std::string& fromPort,
+                             const std::shared_ptr<Node>& toNode, const std::string& toPort) {
+    if (std::find(nodes.begin(), nodes.end(), fromNode) == nodes.end() ||
+        std::find(nodes.begin(), nodes.end(), toNode) == nodes.end()) {
+        LOG_ERROR("Graph", "Invalid node connection!");
+        return;
+    }
+
+    auto findPort = [](const std::vector<Node::Port>& ports, const std::string& name) {
+        return std::find_if(ports.begin(), ports.end(), [&](const Node::Port& p) { return p.name == name; });
+    };
+
+    auto outputs = fromNode->getOutputPorts();
+    auto inputs = toNode->getInputPorts();
+    auto output = findPort(outputs, fromPort);
+    auto input = findPort(inputs, toPort);
+    if (output == outputs.end() || input == inputs.end()) {
+        LOG_ERROR("Graph", "Invalid node connection: no port " << fromNode->name << "." << fromPort << " -> " << toNode->name << "." << toPort);
+        return;
+    }
+    if (output->type == Node::PortType::Image && input->type == Node::PortType::Mask) {
+        LOG_ERROR("Graph", "Invalid node connection: " << toNode->name << "." << toPort << " expects a single-channel mask!");
+        return;
+    }
+    for (const auto& connection : connections) {
+        if (connection.to == toNode && connection.toPort == toPort) {
+            LOG_ERROR("Graph", "Invalid node connection: " << toNode->name << "." << toPort << " is already connected!");
+            return;
+        }
+    }
+
+    connections.push_back({fromNode, fromPort, toNode, toPort});
+    toNode->markDirty();
+}
+
+void NodeGraph::setWorkerCount(size_t count) {
+    if (count == 0) {
+        count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (count != workerCount) {
+        workerCount = count;
+        resetPool();  // Recreated with the new size on the next parallel run
+    }
+}
+
+void NodeGraph::resetPool() {
+    if (pool) {
+        pool.reset();
+        unshareCvThreads();
     }
 }
 
 void NodeGraph::run() {
-    std::cout << "Node graph running with " << nodes.size() << " nodes...\n";
+    LOG_DEBUG("Graph", "run nodes=" << nodes.size());
 
-    for (auto& node : nodes) {
-        node->process();  
+    std::vector<size_t> sinks;
+    if (lazyEvaluation) {
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            if (nodes[i]->isSink()) {
+                sinks.push_back(i);
+            }
+        }
+    }
+
+    int recomputed = evaluate(lazyEvaluation ? &sinks : nullptr);
+    if (recomputed < 0) {
+        LOG_ERROR("Graph", "Node graph contains a cycle, nothing was processed!");
+        return;
+    }
+    LOG_DEBUG("Graph", "run done recomputed=" << recomputed << " nodes=" << nodes.size());
+
+    if (interactive) {
+        for (auto& node : nodes) {
+            node->renderUI();  
+        }
+    }
+}
+
+cv::Mat NodeGraph::pull(const std::shared_ptr<Node>& node, const std::string& port) {
+    pullNode(node.get());
+    return getNodeOutput(node, port);
+}
+
+void NodeGraph::pullNode(const Node* node) {
+    if (evaluating || pullsSuppressed > 0) {
+        return;
+    }
+    auto found = std::find_if(nodes.begin(), nodes.end(), [&](const auto& candidate) { return candidate.get() == node; });
+    if (found == nodes.end()) {
+        LOG_ERROR("Graph", "Cannot pull a node that is not in the graph!");
+        return;
+    }
+    std::vector<size_t> targets{static_cast<size_t>(found - nodes.begin())};
+    if (evaluate(&targets) < 0) {
+        LOG_ERROR("Graph", "Node graph contains a cycle, nothing was processed!");
+    }
+}
+
+std::shared_future<NodeGraph::AsyncResult> NodeGraph::runAsync(std::function<void(const AsyncResult&)> onComplete) {
+    cancelAsync();
+
+    auto job = std::make_shared<AsyncJob>();
+    job->generation = ++asyncGeneration;
+    job->onComplete = std::move(onComplete);
+    std::shared_future<AsyncResult> result = job->promise.get_future().share();
+
+    job->snapshot = std::make_unique<NodeGraph>();
+    if (!makeSnapshot(*job->snapshot)) {
+        AsyncResult failed;
+        failed.generation = job->generation;
+        failed.recomputed = -1;
+        job->promise.set_value(failed);
+        if (job->onComplete) {
+            job->onComplete(failed);
+        }
+        return result;
+    }
+    for (const auto& node : nodes) {
+        job->originals.push_back(node);
+        job->revisions.push_back(node->getRevision());
+    }
+
+    if (!asyncPool) {
+        asyncPool = std::make_unique<ThreadPool>(1);
+    }
+    asyncJob = job;
+    asyncPool->submit([this, job] { executeAsync(job); });
+    return result;
+}
+
+void NodeGraph::cancelAsync() {
+    if (asyncJob) {
+        asyncJob->cancelled = true;
+        asyncJob.reset();
+    }
+}
+
+void NodeGraph::executeAsync(const std::shared_ptr<AsyncJob>& job) {
+    AsyncResult result;
+    result.generation = job->generation;
+
+    NodeGraph& snapshot = *job->snapshot;
+    if (!job->cancelled) {
+        snapshot.cancelRequest = &job->cancelled;
+        std::vector<size_t> sinks;
+        for (size_t i = 0; i < snapshot.nodes.size(); ++i) {
+            if (snapshot.nodes[i]->isSink()) {
+                sinks.push_back(i);
+            }
+        }
+        // A throwing node must not take the background thread down, and the future and
+        // `onComplete` still have to hear about it.
+        try {
+            result.recomputed = snapshot.evaluate(snapshot.lazyEvaluation ? &sinks : nullptr);
+        } catch (const std::exception& e) {
+            result.recomputed = -1;
+            result.error = e.what();
+        } catch (...) {
+            result.recomputed = -1;
+            result.error = "unknown exception";
+        }
+        if (!result.error.empty()) {
+            LOG_ERROR("Graph", "asynchronous run failed generation=" << result.generation << " error=" << result.error);
+        }
+    }
+    result.cancelled = job->cancelled;
+
+    if (!result.cancelled && result.recomputed >= 0) {
+        for (const auto& copy : snapshot.nodes) {
+            NodeState state;
+            state.fusedAway = snapshot.nodeStates.at(copy.get()).fusedAway;
+            for (const auto& port : copy->getOutputPorts()) {
+                cv::Mat value = snapshot.getNodeOutput(copy, port.name);
+                if (!value.empty()) {
+                    state.heldOutputs[port.name] = value;
+                }
+            }
+            job->states.push_back(std::move(state));
+            job->dirty.push_back(copy->isDirty() ? 1 : 0);
+        }
+
+        std::lock_guard<std::mutex> lock(asyncMutex);
+        if (job->generation == asyncGeneration) {
+            asyncFinished = job;
+        }
+    }
+
+    job->promise.set_value(result);
+    if (job->onComplete) {
+        job->onComplete(result);
+    }
+}
+
+bool NodeGraph::pollAsync() {
+    std::shared_ptr<AsyncJob> job;
+    {
+        std::lock_guard<std::mutex> lock(asyncMutex);
+        job = std::move(asyncFinished);
+    }
+    if (!job || job->generation != asyncGeneration) {
+        return false;
+    }
+
+    for (size_t i = 0; i < job->originals.size(); ++i) {
+        const auto& node = job->originals[i];
+        auto found = nodeStates.find(node.get());
+        if (found == nodeStates.end() || node->getRevision() != job->revisions[i]) {
+            continue;  // Removed from the graph, or edited since the snapshot was taken
+        }
+        found->second = std::move(job->states[i]);
+        if (job->dirty[i]) {
+            node->markDirty();
+        } else {
+            node->clearDirty();
+        }
+    }
+    return true;
+}
+
+bool NodeGraph::makeSnapshot(NodeGraph& snapshot) const {
+    snapshot.interactive = false;  // No preview windows from the background thread
+    snapshot.fusionEnabled = fusionEnabled;
+    snapshot.releaseIntermediates = releaseIntermediates;
+    snapshot.lazyEvaluation = lazyEvaluation;
+    snapshot.workerCount = workerCount;
+    snapshot.previewScale = previewScale;
+
+    std::unordered_map<const Node*, std::shared_ptr<Node>> copies;
+    for (const auto& node : nodes) {
+        std::shared_ptr<Node> copy = node->clone();
+        if (!copy) {
+            LOG_ERROR("Graph", "Cannot run asynchronously: node " << node->name << " cannot be cloned!");
+            return false;
+        }
+        copy->setPullHandler(nullptr);
+
+        // The copy must not write into the buffers the original still hands out, so it
+        // forgets them; until it is processed, the graph serves the original's values instead.
+        NodeState state;
+        auto found = nodeStates.find(node.get());
+        state.fusedAway = found != nodeStates.end() && found->second.fusedAway;
+        for (const auto& port : node->getOutputPorts()) {
+            cv::Mat value = getNodeOutput(node, port.name);
+            if (!value.empty()) {
+                state.heldOutputs[port.name] = value;
+            }
+        }
+        copy->releaseOutputs();
+
+        snapshot.addNode(copy);
+        snapshot.nodeStates[copy.get()] = std::move(state);
+        copies[node.get()] = copy;
     }
 
     for (const auto& connection : connections) {
-        const auto& fromNode = connection.first;
-        const auto& toNode = connection.second;
-        
-        toNode->setInput(fromNode->getOutput());
+        snapshot.connections.push_back({copies.at(connection.from.get()), connection.fromPort,
+                                        copies.at(connection.to.get()), connection.toPort});
     }
+    return true;
+}
 
-    for (auto& node : nodes) {
-        node->renderUI();  
+int NodeGraph::evaluate(const std::vector<size_t>* targets) {
+    ScopedFlag scope(evaluating);
+
+    ExecutionPlan plan;
+    if (!buildPlan(plan)) {
+        return -1;
+    }
+    if (targets) {
+        restrictToAncestors(plan, *targets);
+    }
+    if (fusionEnabled) {
+        fusePointwiseChains(plan);
+    }
+
+    std::optional<Profiler::AllocationCounting> counting;
+    if (profilingEnabled) {
+        counting.emplace();
     }
+    prepareNodeStates();
+    RunState state(nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        state.pendingConsumers[i].store(static_cast<int>(plan.downstream[i].size()));
+    }
+    if (workerCount > 1 && plan.order.size() > 1) {
+        runParallel(plan, state);
+    } else {
+        runSerial(plan, state);
+    }
+    return static_cast<int>(std::count(state.recomputed.begin(), state.recomputed.end(), 1));
+}
+
+bool NodeGraph::evaluateNode(size_t index, const ExecutionPlan& plan, RunState& state) {
+    if (cancelRequest && cancelRequest->load(std::memory_order_relaxed)) {
+        return false;  // Superseded async run: skip everything that is left
+    }
+
+    size_t tail = plan.fusedInto[index];
+    if (tail != ExecutionPlan::npos && tail != index) {
+        return false;  // Runs together with the rest of its chain
+    }
+
+    Profiler::Sample begin;
+    if (profilingEnabled) {
+        begin = Profiler::sample();
+    }
+    bool changed = tail == ExecutionPlan::npos ? evaluateSingle(index, plan, state) : evaluateChain(tail, plan, state);
+    if (profilingEnabled && changed) {
+        recordProfile(index, plan, begin);
+    }
+    return changed;
+}
+
+void NodeGraph::recordProfile(size_t index, const ExecutionPlan& plan, const Profiler::Sample& begin) {
+    auto bytesOf = [](const cv::Mat& value) { return value.total() * value.elemSize(); };
+
+    const std::vector<size_t> single{index};
+    const std::vector<size_t>& members = plan.fusedInto[index] == ExecutionPlan::npos ? single : plan.chains.at(index);
+
+    std::string name;
+    size_t bytesRead = 0;
+    for (size_t member : members) {
+        name += (name.empty() ? "" : " + ") + nodes[member]->name;
+        for (size_t c : plan.upstream[member]) {
+            if (c != plan.chainLink[member]) {
+                bytesRead += bytesOf(fetchOutput(connections[c]));
+            }
+        }
+    }
+
+    size_t bytesWritten = 0;
+    const auto& node = nodes[index];
+    for (const auto& port : node->getOutputPorts()) {
+        bytesWritten += bytesOf(fetchOutput({node, port.name, nullptr, std::string()}));
+    }
+
+    profiler.record(name, node->id, begin, bytesRead, bytesWritten);
+}
+
+bool NodeGraph::evaluateSingle(size_t index, const ExecutionPlan& plan, RunState& state) {
+    const auto& node = nodes[index];
+    NodeState& nodeState = nodeStates.at(node.get());
+
+    // Only dirty nodes, nodes downstream of a changed node and nodes whose output was
+    // fused away are processed.
+    bool stale = node->isDirty() || nodeState.fusedAway;
+    for (size_t c : plan.upstream[index]) {
+        if (state.recomputed[plan.source[c]]) {
+            stale = true;
+        }
+    }
+
+    OutputCache::Key key = 0;
+    if (cache.isEnabled()) {
+        key = computeKey(index, plan, state);
+        state.keys[index] = key;
+
+        // Same key as the value already on the output: nothing to do, and nothing changes downstream.
+        if (key == nodeState.outputKey) {
+            node->clearDirty();
+            return false;
+        }
+
+        OutputCache::Entry entry;
+        if (cache.lookup(key, entry)) {
+            nodeState.heldOutputs = std::move(entry);
+            nodeState.outputKey = key;
+            nodeState.fusedAway = false;
+            node->clearDirty();
+            return true;
+        }
+        stale = true;  // e.g. the source file changed on disk
+    }
+
+    if (!stale) {
+        return false;
+    }
+
+    // Each node pulls its input from its upstream node right before it runs,
+    // so a single pass is enough to push fresh data through the whole graph.
+    for (size_t c : plan.upstream[index]) {
+        const Connection& connection = connections[c];
+        node->setInputPort(connection.toPort, fetchOutput(connection));
+    }
+    if (cache.isEnabled()) {
+        node->releaseOutputs();  // The previous outputs may live on in the cache
+    }
+    node->process();
+    node->clearDirty();
+
+    // The node's own output is current again; drop anything the graph held for it.
+    nodeState.heldOutputs.clear();
+    nodeState.outputKey = key;
+    nodeState.fusedAway = false;
+
+    if (cache.isEnabled()) {
+        OutputCache::Entry entry;
+        for (const auto& port : node->getOutputPorts()) {
+            cv::Mat value = node->getOutputPort(port.name);
+            if (!value.empty()) {
+                entry[port.name] = value;
+            }
+        }
+        if (!entry.empty()) {
+            cache.insert(key, entry);
+        }
+    }
+    return true;
+}
+
+bool NodeGraph::evaluateChain(size_t tail, const ExecutionPlan& plan, RunState& state) {
+    const std::vector<size_t>& chain = plan.chains.at(tail);
+    NodeState& tailState = nodeStates.at(nodes[tail].get());
+
+    auto runUnfused = [&] {
+        for (size_t member : chain) {
+            state.recomputed[member] = evaluateSingle(member, plan, state) ? 1 : 0;
+        }
+        return state.recomputed[tail] != 0;
+    };
+
+    // Members before the tail never get an output of their own; drop whatever they still hold.
+    auto fuseAway = [&](size_t member) {
+        NodeState& memberState = nodeStates.at(nodes[member].get());
+        nodes[member]->releaseOutputs();
+        memberState.heldOutputs.clear();
+        memberState.outputKey = 0;
+        memberState.fusedAway = true;
+    };
+
+    // The chain is stale when any member is, or when anything feeding it from outside changed.
+    bool stale = false;
+    for (size_t member : chain) {
+        stale = stale || nodes[member]->isDirty();
+        for (size_t c : plan.upstream[member]) {
+            if (c != plan.chainLink[member] && state.recomputed[plan.source[c]]) {
+                stale = true;
+            }
+        }
+    }
+
+    OutputCache::Key key = 0;
+    if (cache.isEnabled()) {
+        for (size_t member : chain) {
+            state.keys[member] = computeKey(member, plan, state);
+        }
+        key = state.keys[tail];
+
+        OutputCache::Entry entry;
+        bool unchanged = key == tailState.outputKey;
+        if (unchanged || cache.lookup(key, entry)) {
+            for (size_t member : chain) {
+                if (member != tail && state.keys[member] != nodeStates.at(nodes[member].get()).outputKey) {
+                    fuseAway(member);
+                }
+                nodes[member]->clearDirty();
+            }
+            if (unchanged) {
+                return false;
+            }
+            tailState.heldOutputs = std::move(entry);
+            tailState.outputKey = key;
+            tailState.fusedAway = false;
+            return true;
+        }
+        stale = true;
+    }
+
+    if (!stale) {
+        return false;
+    }
+
+    // Stage by stage: the running value arrives over the member's chain link, and a Combine
+    // takes its other operand from outside the chain.
+    PointwiseChain fused;
+    cv::Mat input;
+    for (size_t member : chain) {
+        const PointwiseOp& op = plan.pointwise[member];
+        const size_t link = plan.chainLink[member];
+
+        if (op.kind != PointwiseOp::Kind::Combine) {
+            if (link == ExecutionPlan::npos && !plan.upstream[member].empty()) {
+                input = fetchOutput(connections[plan.upstream[member].front()]);
+            }
+            fused.addStage(op);
+            continue;
+        }
+
+        auto ports = nodes[member]->getInputPorts();
+        if (ports.size() < 2) {
+            return runUnfused();
+        }
+        const std::string chainPort = link != ExecutionPlan::npos ? connections[link].toPort : ports[0].name;
+        const std::string otherPort = chainPort == ports[0].name ? ports[1].name : ports[0].name;
+
+        cv::Mat other;
+        for (size_t c : plan.upstream[member]) {
+            if (connections[c].toPort == otherPort) {
+                other = fetchOutput(connections[c]);
+            } else if (link == ExecutionPlan::npos && connections[c].toPort == chainPort) {
+                input = fetchOutput(connections[c]);
+            }
+        }
+        fused.addStage(op, other, chainPort == ports[0].name);
+    }
+
+    if (!fused.accepts(input)) {
+        return runUnfused();  // e.g. float or 16-bit images, or a blend that has to resize
+    }
+
+    cv::Mat result;
+    result.allocator = outputAllocator();
+    fused.run(input, result);
+
+    for (size_t member : chain) {
+        if (member != tail) {
+            fuseAway(member);
+        }
+        nodes[member]->clearDirty();
+        state.recomputed[member] = 1;
+    }
+
+    const auto& tailNode = nodes[tail];
+    tailNode->releaseOutputs();  // Its own output is stale now
+    tailState.heldOutputs.clear();
+    tailState.heldOutputs[tailNode->getOutputPorts().front().name] = result;
+    tailState.outputKey = key;
+    tailState.fusedAway = false;
+    if (cache.isEnabled()) {
+        cache.insert(key, tailState.heldOutputs);
+    }
+    return true;
+}
+
+OutputCache::Key NodeGraph::computeKey(size_t index, const ExecutionPlan& plan, const RunState& state) const {
+    const auto& node = nodes[index];
+
+    std::ostringstream text;
+    text << node->getType() << '|' << node->id << '|';
+    for (const auto& param : node->getParams()) {
+        text << param.first << '=' << param.second << ';';
+    }
+    if (node->getResolutionScale() != 1.0) {
+        text << "@" << node->getResolutionScale();  // Previews differ from the full render
+    }
+    for (size_t c : plan.upstream[index]) {
+        const Connection& connection = connections[c];
+        text << '|' << connection.toPort << '<' << state.keys[plan.source[c]] << '.' << connection.fromPort;
+    }
+
+    OutputCache::Key key = OutputCache::hash(text.str());
+    return key == 0 ? 1 : key;  // 0 means "unknown"
+}
+
+std::vector<OutputCache::Key> NodeGraph::computeContentKeys() const {
+    ExecutionPlan plan;
+    if (!buildPlan(plan)) {
+        return {};
+    }
+    RunState state(nodes.size());
+    for (size_t index : plan.order) {
+        state.keys[index] = computeKey(index, plan, state);
+    }
+    return state.keys;
+}
+
+cv::Mat NodeGraph::fetchOutput(const Connection& connection) const {
+    auto held = nodeStates.find(connection.from.get());
+    if (held != nodeStates.end()) {
+        auto port = held->second.heldOutputs.find(connection.fromPort);
+        if (port != held->second.heldOutputs.end()) {
+            return port->second;
+        }
+    }
+    return connection.from->getOutputPort(connection.fromPort);
+}
+
+void NodeGraph::prepareNodeStates() {
+    for (const auto& node : nodes) {
+        nodeStates[node.get()];
+        node->setOutputAllocator(outputAllocator());
+    }
+}
+
+void NodeGraph::setBufferPoolEnabled(bool enabled) {
+    if (enabled && !bufferPool) {
+        bufferPool = BufferPool::create();
+    }
+    bufferPoolEnabled = enabled;
+}
+
+cv::Mat NodeGraph::getNodeOutput(const std::shared_ptr<Node>& node, const std::string& port) const {
+    ++pullsSuppressed;
+    cv::Mat value = fetchOutput({node, port, nullptr, std::string()});
+    --pullsSuppressed;
+    return value;
+}
+
+void NodeGraph::runTiled(int tileSize) {
+    LOG_DEBUG("Graph", "run tiled nodes=" << nodes.size() << " tile=" << tileSize);
+
+    ExecutionPlan plan;
+    if (!buildPlan(plan)) {
+        LOG_ERROR("Graph", "Node graph contains a cycle, nothing was processed!");
+        return;
+    }
+    if (tileSize <= 0) {
+        LOG_ERROR("Graph", "Invalid tile size: " << tileSize);
+        return;
+    }
+
+    const size_t count = nodes.size();
+    std::vector<char> tiled(count, 0);
+    for (size_t i = 0; i < count; ++i) {
+        tiled[i] = nodes[i]->isTileable() ? 1 : 0;
+    }
+
+    // Split the graph into whole-frame nodes feeding the tiled region, the tiled region itself,
+    // and whole-frame nodes consuming it. A whole-frame node sitting between two tileable
+    // nodes would need the region to be split in two; such graphs just run untiled.
+    std::vector<char> afterTiled(count, 0);
+    std::vector<char> beforeTiled(count, 0);
+    for (size_t index : plan.order) {
+        for (size_t c : plan.upstream[index]) {
+            size_t from = plan.source[c];
+            if (tiled[from] || afterTiled[from]) {
+                afterTiled[index] = 1;
+            }
+        }
+    }
+    for (auto it = plan.order.rbegin(); it != plan.order.rend(); ++it) {
+        for (size_t next : plan.downstream[*it]) {
+            if (tiled[next] || beforeTiled[next]) {
+                beforeTiled[*it] = 1;
+            }
+        }
+    }
+
+    bool anyTiled = false;
+    bool splitRegion = false;
+    for (size_t i = 0; i < count; ++i) {
+        anyTiled = anyTiled || tiled[i];
+        splitRegion = splitRegion || (!tiled[i] && afterTiled[i] && beforeTiled[i]);
+    }
+    if (!anyTiled || splitRegion) {
+        LOG_INFO("Graph", "no single tileable region, running whole frames instead");
+        run();
+        return;
+    }
+
+    // Liveness release is not applied here: tiles only hold views, and the whole-frame
+    // nodes around the region are few.
+    std::optional<Profiler::AllocationCounting> counting;
+    if (profilingEnabled) {
+        counting.emplace();
+    }
+    prepareNodeStates();
+    RunState state(count);
+
+    // Whole-frame sources, e.g. ImageInputNode.
+    for (size_t index : plan.order) {
+        if (!tiled[index] && !afterTiled[index]) {
+            state.recomputed[index] = evaluateNode(index, plan, state) ? 1 : 0;
+        }
+    }
+
+    // Every whole-frame input entering the region defines the frame; they must agree.
+    cv::Size frame;
+    bool framesAgree = true;
+    for (size_t index : plan.order) {
+        if (!tiled[index]) {
+            continue;
+        }
+        for (size_t c : plan.upstream[index]) {
+            if (tiled[plan.source[c]]) {
+                continue;
+            }
+            cv::Mat value = fetchOutput(connections[c]);
+            if (value.empty() || (frame.area() > 0 && value.size() != frame)) {
+                framesAgree = false;
+            }
+            frame = value.size();
+        }
+    }
+
+    if (!framesAgree || frame.area() == 0) {
+        LOG_WARN("Graph", "tiled region inputs are missing or differ in size, running whole frames instead");
+        for (size_t index : plan.order) {
+            if (tiled[index] || afterTiled[index]) {
+                state.recomputed[index] = evaluateNode(index, plan, state) ? 1 : 0;
+            }
+        }
+        return;
+    }
+
+    std::vector<size_t> region;
+    std::vector<char> exits(count, 0);  // Region nodes whose output leaves the region
+    for (size_t index : plan.order) {
+        if (!tiled[index]) {
+            continue;
+        }
+        region.push_back(index);
+        exits[index] = plan.downstream[index].empty() ? 1 : 0;
+        for (size_t next : plan.downstream[index]) {
+            if (!tiled[next]) {
+                exits[index] = 1;
+            }
+        }
+    }
+
+    const cv::Rect frameRect(cv::Point(0, 0), frame);
+    auto required = [&](size_t index, const cv::Rect& rect) {
+        return nodes[index]->getRequiredInputRect(rect) & frameRect;
+    };
+    auto unite = [](const cv::Rect& a, const cv::Rect& b) {
+        return a.area() == 0 ? b : (b.area() == 0 ? a : (a | b));
+    };
+
+    std::vector<cv::Rect> needed(count);   // Part of each node's output the current tile depends on
+    std::vector<cv::Rect> computed(count); // needed plus the node's halo: what the node actually processes
+    std::vector<std::map<std::string, cv::Mat>> tileOutputs(count);
+    std::vector<std::map<std::string, cv::Mat>> assembled(count);
+
+    for (int ty = 0; ty < frame.height; ty += tileSize) {
+        for (int tx = 0; tx < frame.width; tx += tileSize) {
+            const cv::Rect tile(tx, ty, std::min(tileSize, frame.width - tx), std::min(tileSize, frame.height - ty));
+
+            // Walk the region backwards, growing the tile by what every consumer requires.
+            for (auto it = region.rbegin(); it != region.rend(); ++it) {
+                cv::Rect rect = exits[*it] ? tile : cv::Rect();
+                for (size_t next : plan.downstream[*it]) {
+                    if (tiled[next]) {
+                        rect = unite(rect, required(next, needed[next]));
+                    }
+                }
+                needed[*it] = rect;
+            }
+
+            // Then run it forwards on views into the upstream tiles; nothing here copies pixels
+            // except the final copy of each exit tile into its full-frame result.
+            for (size_t index : region) {
+                const auto& node = nodes[index];
+                computed[index] = required(index, needed[index]);
+
+                Profiler::Sample begin;
+                if (profilingEnabled) {
+                    begin = Profiler::sample();
+                }
+                size_t bytesRead = 0;
+                size_t bytesWritten = 0;
+
+                for (size_t c : plan.upstream[index]) {
+                    const Connection& connection = connections[c];
+                    size_t from = plan.source[c];
+                    cv::Mat view = tiled[from]
+                        ? tileOutputs[from][connection.fromPort](computed[index] - needed[from].tl())
+                        : fetchOutput(connection)(computed[index]);
+                    node->setInputPort(connection.toPort, view);
+                    bytesRead += view.total() * view.elemSize();
+                }
+                node->setRegionOrigin(computed[index].tl());
+                node->process();
+
+                tileOutputs[index].clear();
+                for (const auto& port : node->getOutputPorts()) {
+                    cv::Mat out = node->getOutputPort(port.name);
+                    if (out.empty()) {
+                        continue;
+                    }
+                    if (out.size() != computed[index].size()) {
+                        LOG_ERROR("Graph", "Node " << node->name << " changed the tile size, tiled run aborted!");
+                        for (size_t r : region) {
+                            nodes[r]->setRegionOrigin(cv::Point());
+                            nodes[r]->markDirty();
+                            nodeStates[nodes[r].get()] = NodeState();
+                        }
+                        return;
+                    }
+
+                    bytesWritten += out.total() * out.elemSize();
+                    tileOutputs[index][port.name] = out(cv::Rect(needed[index].tl() - computed[index].tl(), needed[index].size()));
+                    if (exits[index]) {
+                        cv::Mat& full = assembled[index][port.name];
+                        if (full.empty()) {
+                            full.allocator = outputAllocator();
+                            full.create(frame, out.type());
+                        }
+                        out(cv::Rect(tile.tl() - computed[index].tl(), tile.size())).copyTo(full(tile));
+                    }
+                }
+
+                if (profilingEnabled) {
+                    profiler.record(node->name, node->id, begin, bytesRead, bytesWritten);
+                }
+            }
+        }
+    }
+
+    // The graph now holds the full-frame results; the nodes themselves only remember their
+    // last tile, so they stay dirty and a later whole-frame run recomputes them.
+    for (size_t index : region) {
+        NodeState& nodeState = nodeStates[nodes[index].get()];
+        nodeState.heldOutputs = std::move(assembled[index]);
+        nodeState.outputKey = 0;
+        nodeState.fusedAway = false;
+        if (cache.isEnabled()) {
+            // Keep content keys flowing so whole-frame consumers are keyed correctly.
+            state.keys[index] = computeKey(index, plan, state);
+            if (exits[index]) {
+                nodeState.outputKey = state.keys[index];
+                cache.insert(nodeState.outputKey, nodeState.heldOutputs);
+            }
+        }
+        nodes[index]->setRegionOrigin(cv::Point());
+        nodes[index]->markDirty();
+        state.recomputed[index] = 1;
+    }
+
+    // Whole-frame consumers, e.g. OutputNode, read the assembled results.
+    for (size_t index : plan.order) {
+        if (!tiled[index] && afterTiled[index]) {
+            state.recomputed[index] = evaluateNode(index, plan, state) ? 1 : 0;
+        }
+    }
+}
+
+cv::Mat NodeGraph::runRegion(const std::shared_ptr<Node>& target, const cv::Rect& roi, const std::string& port) {
+    auto found = std::find(nodes.begin(), nodes.end(), target);
+    if (found == nodes.end()) {
+        LOG_ERROR("Graph", "Cannot run a region of a node that is not in the graph!");
+        return cv::Mat();
+    }
+    const size_t targetIndex = static_cast<size_t>(found - nodes.begin());
+
+    ExecutionPlan plan;
+    if (!buildPlan(plan)) {
+        LOG_ERROR("Graph", "Node graph contains a cycle, nothing was processed!");
+        return cv::Mat();
+    }
+    restrictToAncestors(plan, {targetIndex});
+
+    // A non-tileable node needs whole frames from everything upstream of it.
+    const size_t count = nodes.size();
+    std::vector<char> whole(count, 0);
+    for (auto it = plan.order.rbegin(); it != plan.order.rend(); ++it) {
+        whole[*it] = nodes[*it]->isTileable() ? 0 : 1;
+        for (size_t next : plan.downstream[*it]) {
+            whole[*it] = whole[*it] || whole[next];
+        }
+    }
+
+    std::vector<size_t> region;
+    std::vector<size_t> wholeInputs;  // Whole-frame nodes feeding the region
+    std::vector<std::shared_ptr<Node>> copies(count);
+    for (size_t index : plan.order) {
+        if (whole[index]) {
+            for (size_t next : plan.downstream[index]) {
+                if (!whole[next]) {
+                    wholeInputs.push_back(index);
+                    break;
+                }
+            }
+            continue;
+        }
+        copies[index] = nodes[index]->clone();
+        if (!copies[index]) {
+            region.clear();  // Cannot evaluate a region without disturbing the node: do it all
+            break;
+        }
+        region.push_back(index);
+    }
+
+    if (region.empty()) {
+        pullNode(target.get());
+        cv::Mat value = getNodeOutput(target, port);
+        return value.empty() ? value : value(roi & cv::Rect(cv::Point(0, 0), value.size()));
+    }
+
+    if (!wholeInputs.empty() && evaluate(&wholeInputs) < 0) {
+        return cv::Mat();
+    }
+
+    std::optional<Profiler::AllocationCounting> counting;
+    if (profilingEnabled) {
+        counting.emplace();
+    }
+
+    // The whole-frame inputs define the frame; they must agree, as for tiled runs.
+    cv::Size frame;
+    for (size_t index : region) {
+        for (size_t c : plan.upstream[index]) {
+            if (!whole[plan.source[c]]) {
+                continue;
+            }
+            cv::Mat value = fetchOutput(connections[c]);
+            if (value.empty() || (frame.area() > 0 && value.size() != frame)) {
+                LOG_ERROR("Graph", "Region inputs are missing or differ in size, nothing was processed!");
+                return cv::Mat();
+            }
+            frame = value.size();
+        }
+    }
+    const cv::Rect frameRect(cv::Point(0, 0), frame);
+
+    // Backwards from the target: the part of each node's output its consumers depend on.
+    std::vector<cv::Rect> needed(count);
+    for (auto it = region.rbegin(); it != region.rend(); ++it) {
+        cv::Rect rect = *it == targetIndex ? (roi & frameRect) : cv::Rect();
+        for (size_t next : plan.downstream[*it]) {
+            cv::Rect required = nodes[next]->getRequiredInputRect(needed[next]) & frameRect;
+            rect = rect.area() == 0 ? required : (required.area() == 0 ? rect : (rect | required));
+        }
+        needed[*it] = rect;
+    }
+    if (needed[targetIndex].area() == 0) {
+        return cv::Mat();
+    }
+
+    // Forwards on views: every clone sees only the rect it requires of its inputs.
+    std::vector<std::map<std::string, cv::Mat>> outputs(count);
+    for (size_t index : region) {
+        const auto& copy = copies[index];
+        copy->setPullHandler(nullptr);
+        copy->setOutputAllocator(outputAllocator());
+        copy->releaseOutputs();  // Do not write into the buffers the original still hands out
+
+        const cv::Rect computed = copy->getRequiredInputRect(needed[index]) & frameRect;
+        Profiler::Sample begin;
+        if (profilingEnabled) {
+            begin = Profiler::sample();
+        }
+        size_t bytesRead = 0;
+        size_t bytesWritten = 0;
+
+        for (size_t c : plan.upstream[index]) {
+            const Connection& connection = connections[c];
+            size_t from = plan.source[c];
+            cv::Mat view = whole[from]
+                ? fetchOutput(connection)(computed)
+                : outputs[from][connection.fromPort](computed - needed[from].tl());
+            copy->setInputPort(connection.toPort, view);
+            bytesRead += view.total() * view.elemSize();
+        }
+        copy->setRegionOrigin(computed.tl());
+        copy->process();
+
+        for (const auto& output : copy->getOutputPorts()) {
+            cv::Mat value = copy->getOutputPort(output.name);
+            if (value.empty()) {
+                continue;
+            }
+            if (value.size() != computed.size()) {
+                LOG_ERROR("Graph", "Node " << copy->name << " changed the region size, nothing was returned!");
+                return cv::Mat();
+            }
+            bytesWritten += value.total() * value.elemSize();
+            outputs[index][output.name] = value(cv::Rect(needed[index].tl() - computed.tl(), needed[index].size()));
+        }
+
+        if (profilingEnabled) {
+            profiler.record(copy->name, copy->id, begin, bytesRead, bytesWritten);
+        }
+    }
+    return outputs[targetIndex][port];
+}
+
+void NodeGraph::releaseConsumedSources(size_t index, const ExecutionPlan& plan, RunState& state) {
+    if (!releaseIntermediates) {
+        return;
+    }
+
+    // A fused chain reads all of its members' inputs when its last node runs.
+    size_t tail = plan.fusedInto[index];
+    if (tail != ExecutionPlan::npos && tail != index) {
+        return;
+    }
+    const std::vector<size_t> single{index};
+    const std::vector<size_t>& members = tail == ExecutionPlan::npos ? single : plan.chains.at(tail);
+
+    for (size_t member : members) {
+        for (size_t c : plan.upstream[member]) {
+            size_t from = plan.source[c];
+            if (state.pendingConsumers[from].fetch_sub(1, std::memory_order_acq_rel) != 1) {
+                continue;
+            }
+
+            // Last consumer done: nothing reads this node again during the run.
+            const auto& node = nodes[from];
+            node->releaseOutputs();
+            node->releaseInputs();
+            node->markDirty();
+
+            NodeState& nodeState = nodeStates.at(node.get());
+            nodeState.heldOutputs.clear();
+            nodeState.outputKey = 0;
+        }
+    }
+}
+
+void NodeGraph::runSerial(const ExecutionPlan& plan, RunState& state) {
+    for (size_t index : plan.order) {
+        state.recomputed[index] = evaluateNode(index, plan, state) ? 1 : 0;
+        releaseConsumedSources(index, plan, state);
+    }
+}
+
+void NodeGraph::runParallel(const ExecutionPlan& plan, RunState& state) {
+    if (!pool) {
+        pool = std::make_unique<ThreadPool>(workerCount);
+        shareCvThreads(pool->size());
+    }
+
+    std::vector<std::atomic<int>> remaining(nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        remaining[i].store(static_cast<int>(plan.upstream[i].size()));
+    }
+
+    std::mutex errorMutex;
+    std::exception_ptr firstError;
+
+    // A node is dispatched as soon as its last upstream node finishes. The atomic
+    // countdown also publishes the upstream outputs to whichever worker picks it up.
+    std::function<void(size_t)> dispatch = [&](size_t index) {
+        pool->submit([&, index] {
+            try {
+                state.recomputed[index] = evaluateNode(index, plan, state) ? 1 : 0;
+                releaseConsumedSources(index, plan, state);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!firstError) {
+                    firstError = std::current_exception();
+                }
+            }
+            for (size_t next : plan.downstream[index]) {
+                if (remaining[next].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    dispatch(next);
+                }
+            }
+        });
+    };
+
+    for (size_t index : plan.order) {
+        if (plan.upstream[index].empty()) {
+            dispatch(index);
+        }
+    }
+    pool->waitIdle();
+
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+}
+
+bool NodeGraph::buildPlan(ExecutionPlan& plan) const {
+    plan.order.clear();
+    plan.upstream.assign(nodes.size(), {});
+    plan.downstream.assign(nodes.size(), {});
+    plan.source.assign(connections.size(), 0);
+    plan.fusedInto.assign(nodes.size(), ExecutionPlan::npos);
+    plan.chainLink.assign(nodes.size(), ExecutionPlan::npos);
+    plan.chains.clear();
+    plan.pointwise.assign(nodes.size(), PointwiseOp());
+
+    std::unordered_map<Node*, size_t> indexOf;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        indexOf[nodes[i].get()] = i;
+    }
+
+    std::vector<int> inDegree(nodes.size(), 0);
+    for (size_t c = 0; c < connections.size(); ++c) {
+        size_t from = indexOf[connections[c].from.get()];
+        size_t to = indexOf[connections[c].to.get()];
+        plan.source[c] = from;
+        plan.upstream[to].push_back(c);
+        plan.downstream[from].push_back(to);
+        ++inDegree[to];
+    }
+
+    // Kahn's algorithm; ready nodes are taken in insertion order so runs are deterministic.
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (inDegree[i] == 0) {
+            plan.order.push_back(i);
+        }
+    }
+
+    for (size_t head = 0; head < plan.order.size(); ++head) {
+        for (size_t next : plan.downstream[plan.order[head]]) {
+            if (--inDegree[next] == 0) {
+                plan.order.push_back(next);
+            }
+        }
+    }
+
+    if (plan.order.size() != nodes.size()) {
+        plan.order.clear();
+        return false;
+    }
+    return true;
+}
+
+void NodeGraph::restrictToAncestors(ExecutionPlan& plan, const std::vector<size_t>& targets) const {
+    std::vector<char> needed(nodes.size(), 0);
+    std::vector<size_t> stack(targets.begin(), targets.end());
+    while (!stack.empty()) {
+        size_t index = stack.back();
+        stack.pop_back();
+        if (needed[index]) {
+            continue;
+        }
+        needed[index] = 1;
+        for (size_t c : plan.upstream[index]) {
+            stack.push_back(plan.source[c]);
+        }
+    }
+
+    // Needed nodes only have needed upstream nodes, so trimming the order and the downstream
+    // lists is enough: nothing dispatches or waits for the nodes left out.
+    plan.order.erase(std::remove_if(plan.order.begin(), plan.order.end(), [&](size_t index) { return !needed[index]; }),
+                     plan.order.end());
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (!needed[i]) {
+            plan.downstream[i].clear();
+            plan.upstream[i].clear();
+            continue;
+        }
+        auto& next = plan.downstream[i];
+        next.erase(std::remove_if(next.begin(), next.end(), [&](size_t index) { return !needed[index]; }), next.end());
+    }
+}
+
+void NodeGraph::fusePointwiseChains(ExecutionPlan& plan) const {
+    const size_t count = nodes.size();
+    std::vector<char> pointwise(count, 0);
+    for (size_t i = 0; i < count; ++i) {
+        pointwise[i] = nodes[i]->getPointwiseOp(plan.pointwise[i]) ? 1 : 0;
+    }
+
+    // A pointwise node extends the chain of a pointwise upstream node it is that node's only
+    // consumer; otherwise it starts a chain of its own. Chains are therefore simple paths.
+    std::vector<size_t> head(count, ExecutionPlan::npos);
+    std::map<size_t, std::vector<size_t>> members;  // Chain head -> members in order
+    for (size_t index : plan.order) {
+        if (!pointwise[index]) {
+            continue;
+        }
+        head[index] = index;
+        for (size_t c : plan.upstream[index]) {
+            size_t from = plan.source[c];
+            if (pointwise[from] && plan.downstream[from].size() == 1) {
+                head[index] = head[from];
+                plan.chainLink[index] = c;
+                break;
+            }
+        }
+        members[head[index]].push_back(index);
+    }
+
+    for (auto& chain : members) {
+        if (chain.second.size() < 2) {
+            plan.chainLink[chain.second.front()] = ExecutionPlan::npos;
+            continue;
+        }
+        size_t tail = chain.second.back();
+        for (size_t member : chain.second) {
+            plan.fusedInto[member] = tail;
+        }
+        plan.chains[tail] = std::move(chain.second);
+    }
+}
+
+bool NodeGraph::buildExecutionOrder(std::vector<std::shared_ptr<Node>>& order) const {
+    order.clear();
+
+    ExecutionPlan plan;
+    if (!buildPlan(plan)) {
+        return false;
+    }
+    for (size_t index : plan.order) {
+        order.push_back(nodes[index]);
+    }
+    return true;
 }
 
 void NodeGraph::clear() {
+    for (auto& node : nodes) {
+        node->setPullHandler(nullptr);  // Removed nodes no longer pull through this graph
+    }
     nodes.clear();
     connections.clear();
+    nodeStates.clear();
 }
 
 const std::vector<std::shared_ptr<Node>>& NodeGraph::getNodes() const {
     return nodes;
 }
+
+const std::vector<NodeGraph::Connection>& NodeGraph::getConnections() const {
+    return connections;
+}
@@ -1,20 +1,291 @@
 #pragma once
+#include <atomic>
+#include <functional>
+#include <future>
 #include <vector>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "BufferPool.hpp"
 #include "Node.hpp"
+#include "ThreadPool.hpp"
+#include "OutputCache.hpp"
+#include "Profiler.hpp"
 
 class NodeGraph {
 public:
+    // A directed edge from an output port of one node to an input port of another.
+    struct Connection {
+        std::shared_ptr<Node> from;
+        std::string fromPort;
+        std::shared_ptr<Node> to;
+        std::string toPort;
+    };
+
+    NodeGraph() = default;
+    ~NodeGraph();
+
     void addNode(const std::shared_ptr<Node>& node);
+
+    // Processes dirty nodes and their downstream closure in topological order.
+    // With more than one worker, independent branches run concurrently.
     void run();
 
+    // Brings `node` and the nodes it depends on up to date, leaving every other node alone,
+    // and returns the node's output on `port`.
+    cv::Mat pull(const std::shared_ptr<Node>& node, const std::string& port = "output");
+
+    // Lazy (pull) evaluation: run() only evaluates nodes that some sink (Node::isSink())
+    // depends on, so branches that feed no sink cost nothing, and calling getOutput() on a
+    // sink pulls it up to date without a run(). Off by default.
+    void setLazyEvaluation(bool enabled);
+    bool isLazyEvaluation() const { return lazyEvaluation; }
+
+    // Preview mode: with a scale below 1, sources produce a proxy downscaled by `scale` from a
+    // cached image pyramid and nodes rescale their pixel-sized parameters to match (see
+    // Node::setResolutionScale()), so each edit re-evaluates a fraction of the pixels. Sinks
+    // do not write files during previews. 1 (the default) evaluates at full resolution.
+    void setPreviewScale(double scale);
+    double getPreviewScale() const { return previewScale; }
+
+    // A run() at full resolution, e.g. to export through OutputNode, after which the graph is
+    // back in preview mode. With the cache enabled, the preview results are fetched back
+    // afterwards instead of recomputed.
+    void renderFullResolution();
+
+    // Outcome of one runAsync() call.
+    struct AsyncResult {
+        uint64_t generation = 0;  // Which runAsync() call this answers, counting from 1
+        bool cancelled = false;   // Cancelled or superseded before it finished; nothing is delivered
+        int recomputed = 0;       // Nodes processed, -1 on a cycle, a node without clone() or an error
+        std::string error;        // What a node threw during the run; empty otherwise
+    };
+
+    // Evaluates a snapshot of the graph on a background thread and returns immediately, so an
+    // interactive caller never waits for image processing. The snapshot holds clones of the
+    // nodes (Node::clone()), so the caller may keep editing the originals meanwhile, and each
+    // call cancels the run still in flight, which stops before its next node. The future and
+    // `onComplete` (called on the background thread) report the outcome; the outputs reach
+    // the nodes through pollAsync(). Buffer pooling and profiling are not used by async runs.
+    std::shared_future<AsyncResult> runAsync(std::function<void(const AsyncResult&)> onComplete = nullptr);
+    void cancelAsync();
+
+    // Hands the outputs of the latest finished runAsync() to the graph, where getNodeOutput()
+    // and later runs see them. Nodes edited since that run started keep their dirty flag.
+    // Call from the thread that edits the graph, e.g. once per UI frame; returns true if a
+    // new result was applied.
+    bool pollAsync();
+
+    // Runs the graph tile by tile: the tileable nodes are evaluated on tileSize x tileSize
+    // tiles (plus each node's halo) one tile at a time, so intermediate buffers scale with
+    // the tile size instead of the frame size and stay cache-resident between stages.
+    // Non-tileable nodes before and after that region still see whole frames. Falls back
+    // to run() when the graph cannot be tiled.
+    void runTiled(int tileSize = 256);
+
+    // Computes only `roi` (frame coordinates) of a node's output, e.g. the visible part of a
+    // zoomed-in view. Walking upstream, every tileable node maps the region to the input region
+    // it requires (Node::getRequiredInputRect()) and processes cv::Mat views of just that, on a
+    // clone, so the nodes keep their full-frame outputs. Whatever feeds a non-tileable node is
+    // evaluated on whole frames as by pull(). Returns an empty Mat on error.
+    cv::Mat runRegion(const std::shared_ptr<Node>& node, const cv::Rect& roi, const std::string& port = "output");
+
+    // Connects the first output port of `fromNode` to the first input port of `toNode`.
     void connectNodes(const std::shared_ptr<Node>& fromNode, const std::shared_ptr<Node>& toNode);
 
+    // Connects two named ports. Each input port accepts a single connection, and an
+    // Image output cannot feed a Mask input.
+    void connectNodes(const std::shared_ptr<Node>& fromNode, const std::string& fromPort,
+                      const std::shared_ptr<Node>& toNode, const std::string& toPort);
+
     void clear();
 
     const std::vector<std::shared_ptr<Node>>& getNodes() const;
+    const std::vector<Connection>& getConnections() const;
+
+    // Latest value of a node's output port. Prefer this over Node::getOutputPort(): after a
+    // tiled run the full-frame result is held by the graph, not by the node. Never evaluates
+    // anything, even for a sink of a lazy graph; use pull() for that.
+    cv::Mat getNodeOutput(const std::shared_ptr<Node>& node, const std::string& port = "output") const;
+
+    // Orders nodes so every node comes after all of its upstream nodes.
+    // Returns false (and leaves `order` empty) if the connections contain a cycle.
+    bool buildExecutionOrder(std::vector<std::shared_ptr<Node>>& order) const;
+
+    // Number of threads used to run independent nodes in parallel.
+    // 0 picks the hardware concurrency, 1 (the default) runs everything on the calling thread.
+    void setWorkerCount(size_t count);
+    size_t getWorkerCount() const { return workerCount; }
+
+    // Memory budget for memoized node outputs, in bytes; 0 (the default) disables caching.
+    // With a budget, a node whose parameters and upstream results hash to a key seen before
+    // reuses the cached result instead of processing, and a node whose key did not change
+    // since it last ran is skipped even if it was marked dirty.
+    void setCacheBudget(size_t bytes) { cache.setBudget(bytes); }
+    OutputCache& getCache() { return cache; }
+    const OutputCache& getCache() const { return cache; }
+
+    // Content key of every node for its current parameters and upstream keys, indexed like
+    // getNodes(); the key the cache would store the node's output under. Empty on a cycle.
+    std::vector<OutputCache::Key> computeContentKeys() const;
+
+    // Allocate the nodes' outputs from the graph's BufferPool, so intermediates of the same
+    // footprint recycle each other's memory across nodes and across runs. Scratch Mats inside
+    // a node and Mats created outside the graph keep using OpenCV's default allocator.
+    void setBufferPoolEnabled(bool enabled);
+    bool isBufferPoolEnabled() const { return bufferPoolEnabled; }
+    BufferPool* getBufferPool() const { return bufferPool.get(); }  // nullptr until pooling is enabled
+
+    // Free each intermediate node's buffers as soon as its last consumer has run, so a run
+    // only holds the images that are still live. Released nodes are marked dirty, which makes
+    // the next run recompute them (or fetch them from the cache); meant for one-shot and batch
+    // evaluation rather than interactive editing. Sinks are never released.
+    void setReleaseIntermediates(bool enabled) { releaseIntermediates = enabled; }
+    bool isReleasingIntermediates() const { return releaseIntermediates; }
+
+    // Fuse chains of per-pixel nodes (see Node::getPointwiseOp) into a single pass over memory
+    // during run(). Only the last node of a chain produces an output, held by the graph; the
+    // nodes fused away have none until they run unfused again, so getNodeOutput() returns an
+    // empty Mat for them. Chains whose inputs turn out not to be 8-bit run node by node.
+    void setFusionEnabled(bool enabled) { fusionEnabled = enabled; }
+    bool isFusionEnabled() const { return fusionEnabled; }
+
+    // Record wall time, CPU time, bytes read and written and allocations of every node that
+    // does work during run() and runTiled() (tiled nodes once per tile). Records accumulate
+    // in getProfiler() until it is cleared; see Profiler::writeChromeTrace().
+    void setProfilingEnabled(bool enabled) { profilingEnabled = enabled; }
+    bool isProfilingEnabled() const { return profilingEnabled; }
+    Profiler& getProfiler() { return profiler; }
+    const Profiler& getProfiler() const { return profiler; }
+
+    // An interactive graph (the default) calls renderUI() on every node after run(). A headless
+    // one does not, and switches off its nodes' preview windows, key waits and debug images,
+    // including nodes added later.
+    void setInteractive(bool enabled);
+    bool isInteractive() const { return interactive; }
 
 private:
+    // Topological schedule plus the adjacency needed to execute it, all by index into `nodes`.
+    struct ExecutionPlan {
+        static constexpr size_t npos = static_cast<size_t>(-1);
+
+        std::vector<size_t> order;
+        std::vector<std::vector<size_t>> upstream;    // Connection indices feeding each node
+        std::vector<std::vector<size_t>> downstream;  // Node indices fed by each node
+        std::vector<size_t> source;                   // Node index at the start of each connection
+
+        // Pointwise fusion, filled in by fusePointwiseChains().
+        std::vector<size_t> fusedInto;                // Last node of the chain each node belongs to, or npos
+        std::vector<size_t> chainLink;                // Connection bringing the chain's value into each node, or npos
+        std::map<size_t, std::vector<size_t>> chains; // Last node -> chain members in order
+        std::vector<PointwiseOp> pointwise;           // Op of every chain member
+    };
+
+    // Per-run bookkeeping, indexed like `nodes`. Each entry is only written by the task
+    // evaluating that node, and only read by tasks downstream of it.
+    struct RunState {
+        explicit RunState(size_t count) : recomputed(count, 0), keys(count, 0), pendingConsumers(count) {}
+        std::vector<char> recomputed;           // Output changed during this run
+        std::vector<OutputCache::Key> keys;     // Content key of each node's output
+        std::vector<std::atomic<int>> pendingConsumers;  // Consumers still to run, with releaseIntermediates
+    };
+
+    // What the graph remembers about a node between runs.
+    struct NodeState {
+        // Port values the graph keeps on behalf of the node, e.g. tiles assembled into a full
+        // frame or a cache hit. They take precedence over the node's own output until the
+        // node is processed again.
+        std::map<std::string, cv::Mat> heldOutputs;
+        OutputCache::Key outputKey = 0;  // Key of the value the node currently outputs, 0 if unknown
+        bool fusedAway = false;          // Fused into a chain, so the node's own output was never produced
+    };
+
+    bool buildPlan(ExecutionPlan& plan) const;
+
+    // Drops every node that none of `targets` depends on from the plan.
+    void restrictToAncestors(ExecutionPlan& plan, const std::vector<size_t>& targets) const;
+
+    // Plans and evaluates the graph, or only what `targets` depend on when given.
+    // Returns the number of nodes recomputed, or -1 if the graph contains a cycle.
+    int evaluate(const std::vector<size_t>* targets);
+
+    // Pull handler of a sink in a lazy graph; ignored while the graph is already evaluating.
+    void pullNode(const Node* node);
+
+    // One runAsync() call: the snapshot it evaluates and, once finished, its outputs.
+    struct AsyncJob;
+
+    // Fills an empty graph with clones of the nodes, their connections, what the graph holds
+    // for them and the evaluation settings. Fails if a node cannot be cloned.
+    bool makeSnapshot(NodeGraph& snapshot) const;
+
+    // Body of a runAsync() job, on the background thread.
+    void executeAsync(const std::shared_ptr<AsyncJob>& job);
+
+    // Groups pointwise nodes into chains where each member's only consumer is the next member.
+    void fusePointwiseChains(ExecutionPlan& plan) const;
+
+    // Evaluates node `index`, or the whole chain when it ends a fused chain; other chain members
+    // are skipped and run with their chain. Returns true when the node's output changed.
+    bool evaluateNode(size_t index, const ExecutionPlan& plan, RunState& state);
+
+    // Pulls inputs and processes node `index` if it is dirty, an upstream node changed or
+    // (with caching) its content key changed. Returns true when the node's output changed.
+    bool evaluateSingle(size_t index, const ExecutionPlan& plan, RunState& state);
+
+    // Runs the chain ending at `tail` as one PointwiseChain pass, or node by node when its
+    // inputs do not allow it. Returns true when the tail's output changed.
+    bool evaluateChain(size_t tail, const ExecutionPlan& plan, RunState& state);
+
+    // Adds a profiler record for node `index` (or the chain it ends) evaluated since `begin`.
+    void recordProfile(size_t index, const ExecutionPlan& plan, const Profiler::Sample& begin);
+
+    // Hash of the node's type, id, parameters and the keys of its upstream outputs.
+    OutputCache::Key computeKey(size_t index, const ExecutionPlan& plan, const RunState& state) const;
+
+    // Value flowing along a connection, preferring what the graph holds for the source node.
+    cv::Mat fetchOutput(const Connection& connection) const;
+
+    // Makes sure every node has a slot in nodeStates, so workers never insert concurrently,
+    // and hands every node the output allocator.
+    void prepareNodeStates();
+
+    // The buffer pool while pooling is enabled, nullptr for OpenCV's default allocator.
+    cv::MatAllocator* outputAllocator() const { return bufferPoolEnabled ? bufferPool.get() : nullptr; }
+
+    // Counts down the consumers of node `index`'s sources and releases those nobody needs anymore.
+    void releaseConsumedSources(size_t index, const ExecutionPlan& plan, RunState& state);
+
+    void runSerial(const ExecutionPlan& plan, RunState& state);
+    void runParallel(const ExecutionPlan& plan, RunState& state);
+    void resetPool();
+
     std::vector<std::shared_ptr<Node>> nodes; 
-    std::vector<std::pair<std::shared_ptr<Node>, std::shared_ptr<Node>>> connections;  
+    std::vector<Connection> connections;
+
+    std::unordered_map<const Node*, NodeState> nodeStates;
+    OutputCache cache;
+    Profiler profiler;
+
+    bool bufferPoolEnabled = false;
+    BufferPool::Handle bufferPool;  // Created when pooling is first enabled
+    bool releaseIntermediates = false;
+    bool fusionEnabled = false;
+    bool profilingEnabled = false;
+    bool interactive = true;
+    bool lazyEvaluation = false;
+    double previewScale = 1.0;
+    bool evaluating = false;  // Inside run() or pull(); sinks read during evaluation must not pull again
+
+    const std::atomic<bool>* cancelRequest = nullptr;  // Set on async snapshots, checked before each node
+    std::unique_ptr<ThreadPool> asyncPool;             // The background thread of runAsync()
+    std::shared_ptr<AsyncJob> asyncJob;                // Latest job, only touched by the editing thread
+    std::atomic<uint64_t> asyncGeneration{0};
+    std::mutex asyncMutex;
+    std::shared_ptr<AsyncJob> asyncFinished;           // Finished, not yet polled; guarded by asyncMutex
+
+    size_t workerCount = 1;
+    std::unique_ptr<ThreadPool> pool;
 };
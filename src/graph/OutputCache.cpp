@@ -0,0 +1,72 @@
+#include "OutputCache.hpp"
+
+void OutputCache::setBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    budget = bytes;
+    evictToBudget();
+}
+
+bool OutputCache::lookup(Key key, Entry& entry) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = index.find(key);
+    if (found == index.end()) {
+        ++misses;
+        return false;
+    }
+    items.splice(items.begin(), items, found->second);
+    entry = found->second->entry;
+    ++hits;
+    return true;
+}
+
+void OutputCache::insert(Key key, const Entry& entry) {
+    size_t bytes = 0;
+    for (const auto& port : entry) {
+        bytes += port.second.total() * port.second.elemSize();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (bytes > budget) {
+        return;  // Would evict everything and still not fit
+    }
+
+    auto found = index.find(key);
+    if (found != index.end()) {
+        bytesUsed -= found->second->bytes;
+        items.erase(found->second);
+    }
+    items.push_front({key, entry, bytes});
+    index[key] = items.begin();
+    bytesUsed += bytes;
+    evictToBudget();
+}
+
+void OutputCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    items.clear();
+    index.clear();
+    bytesUsed = 0;
+}
+
+size_t OutputCache::getBytesUsed() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytesUsed;
+}
+
+void OutputCache::evictToBudget() {
+    while (bytesUsed > budget && !items.empty()) {
+        bytesUsed -= items.back().bytes;
+        index.erase(items.back().key);
+        items.pop_back();
+    }
+}
+
+OutputCache::Key OutputCache::hash(const std::string& text) {
+    // 64-bit FNV-1a
+    Key value = 1469598103934665603ull;
+    for (unsigned char c : text) {
+        value ^= c;
+        value *= 1099511628211ull;
+    }
+    return value;
+}
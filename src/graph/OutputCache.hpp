@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <opencv2/opencv.hpp>
+
+// Memoizes node outputs by content key: a hash of the node's type, parameters and the keys
+// of everything upstream. Entries are evicted least-recently-used first once the total
+// size of the cached images exceeds the memory budget. Safe to use from several workers.
+class OutputCache {
+public:
+    using Key = uint64_t;
+    using Entry = std::map<std::string, cv::Mat>;  // Output port name -> value
+
+    // Budget in bytes of pixel data; 0 disables the cache and drops every entry.
+    void setBudget(size_t bytes);
+    size_t getBudget() const { return budget; }
+    bool isEnabled() const { return budget > 0; }
+
+    // Copies the entry's headers into `entry` and marks it most recently used.
+    bool lookup(Key key, Entry& entry);
+    void insert(Key key, const Entry& entry);
+    void clear();
+
+    size_t getBytesUsed() const;
+    size_t getHits() const { return hits; }
+    size_t getMisses() const { return misses; }
+
+    static Key hash(const std::string& text);
+
+private:
+    struct Item {
+        Key key;
+        Entry entry;
+        size_t bytes;
+    };
+
+    void evictToBudget();
+
+    std::list<Item> items;  // Most recently used first
+    std::unordered_map<Key, std::list<Item>::iterator> index;
+    size_t budget = 0;
+    size_t bytesUsed = 0;
+    size_t hits = 0;
+    size_t misses = 0;
+    mutable std::mutex mutex;
+};
@@ -0,0 +1,58 @@
+#pragma once
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+// A node's parameters as name -> textual value. NodeGraph hashes them to key its output cache.
+using ParamMap = std::map<std::string, std::string>;
+
+inline std::string toParam(const std::string& value) { return value; }
+inline std::string toParam(bool value) { return value ? "1" : "0"; }
+
+// Numbers are written with enough digits to round-trip exactly.
+template <typename T>
+std::string toParam(T value) {
+    static_assert(std::is_arithmetic<T>::value, "toParam expects a number, bool or string");
+    std::ostringstream out;
+    out << std::setprecision(std::numeric_limits<T>::max_digits10) << value;
+    return out.str();
+}
+
+// Reads params[key] back into `value`. Returns false, leaving `value` untouched, when the key
+// is missing or does not parse.
+inline bool readParam(const ParamMap& params, const std::string& key, std::string& value) {
+    auto found = params.find(key);
+    if (found == params.end()) {
+        return false;
+    }
+    value = found->second;
+    return true;
+}
+
+inline bool readParam(const ParamMap& params, const std::string& key, bool& value) {
+    auto found = params.find(key);
+    if (found == params.end() || (found->second != "0" && found->second != "1")) {
+        return false;
+    }
+    value = found->second == "1";
+    return true;
+}
+
+template <typename T>
+bool readParam(const ParamMap& params, const std::string& key, T& value) {
+    static_assert(std::is_arithmetic<T>::value, "readParam expects a number, bool or string");
+    auto found = params.find(key);
+    if (found == params.end()) {
+        return false;
+    }
+    std::istringstream in(found->second);
+    T parsed;
+    if (!(in >> parsed) || !(in >> std::ws).eof()) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
@@ -0,0 +1,131 @@
+#include "PointwiseChain.hpp"
+#include <cstring>
+
+void PointwiseChain::addStage(const PointwiseOp& op, const cv::Mat& other, bool chainIsA) {
+    stages.push_back({op, other, chainIsA});
+}
+
+bool PointwiseChain::accepts(const cv::Mat& input) const {
+    return !channelFlow(input).empty();
+}
+
+std::vector<int> PointwiseChain::channelFlow(const cv::Mat& input) const {
+    if (input.empty() || input.depth() != CV_8U || input.channels() > 4) {
+        return {};
+    }
+
+    std::vector<int> channels;
+    int current = input.channels();
+    for (const auto& stage : stages) {
+        switch (stage.op.kind) {
+        case PointwiseOp::Kind::Map:
+            if (stage.op.table.size() != 256) {
+                return {};
+            }
+            break;
+        case PointwiseOp::Kind::GrayMap:
+            if (stage.op.table.size() != 256 || current == 2) {
+                return {};
+            }
+            current = 1;
+            break;
+        case PointwiseOp::Kind::Combine: {
+            if (stage.op.table.size() != 256 * 256 || stage.other.empty() ||
+                stage.other.depth() != CV_8U || stage.other.size() != input.size()) {
+                return {};
+            }
+            int other = stage.other.channels();
+            if (other != current && !((other == 1 && current == 3) || (other == 3 && current == 1))) {
+                return {};
+            }
+            current = std::max(current, other);
+            break;
+        }
+        }
+        channels.push_back(current);
+    }
+    return channels;
+}
+
+void PointwiseChain::run(const cv::Mat& input, cv::Mat& output) const {
+    std::vector<int> channels = channelFlow(input);
+    CV_Assert(!channels.empty());
+
+    cv::Mat result;
+    result.allocator = output.allocator;  // e.g. the graph's buffer pool
+    result.create(input.size(), CV_8UC(channels.back()));
+    cv::parallel_for_(cv::Range(0, input.rows), [&](const cv::Range& rows) {
+        runRows(input, result, channels, rows.start, rows.end);
+    });
+    output = result;
+}
+
+void PointwiseChain::runRows(const cv::Mat& input, cv::Mat& output, const std::vector<int>& channels,
+                             int begin, int end) const {
+    const int cols = input.cols;
+    std::vector<uchar> value(static_cast<size_t>(cols) * 4);
+    std::vector<uchar> gray(cols);
+
+    for (int y = begin; y < end; ++y) {
+        int current = input.channels();
+        std::memcpy(value.data(), input.ptr<uchar>(y), static_cast<size_t>(cols) * current);
+
+        for (size_t s = 0; s < stages.size(); ++s) {
+            const Stage& stage = stages[s];
+            const uchar* table = stage.op.table.data();
+
+            switch (stage.op.kind) {
+            case PointwiseOp::Kind::Map:
+                for (int i = 0; i < cols * current; ++i) {
+                    value[i] = table[value[i]];
+                }
+                break;
+
+            case PointwiseOp::Kind::GrayMap:
+                if (current != 1) {
+                    // Let OpenCV do the conversion so the gray values match ThresholdNode's exactly.
+                    cv::Mat colorRow(1, cols, CV_8UC(current), value.data());
+                    cv::Mat grayRow(1, cols, CV_8UC1, gray.data());
+                    cv::cvtColor(colorRow, grayRow, cv::COLOR_BGR2GRAY);
+                    std::memcpy(value.data(), gray.data(), cols);
+                }
+                for (int x = 0; x < cols; ++x) {
+                    value[x] = table[value[x]];
+                }
+                break;
+
+            case PointwiseOp::Kind::Combine: {
+                const uchar* other = stage.other.ptr<uchar>(y);
+                const int otherChannels = stage.other.channels();
+                auto combine = [&](uchar chain, uchar side) {
+                    return stage.chainIsA ? table[chain * 256 + side] : table[side * 256 + chain];
+                };
+
+                if (current == otherChannels) {
+                    for (int i = 0; i < cols * current; ++i) {
+                        value[i] = combine(value[i], other[i]);
+                    }
+                } else if (current == 1) {
+                    // Gray running value against a BGR operand: widen in place, back to front.
+                    for (int x = cols - 1; x >= 0; --x) {
+                        uchar v = value[x];
+                        for (int c = 2; c >= 0; --c) {
+                            value[x * 3 + c] = combine(v, other[x * 3 + c]);
+                        }
+                    }
+                } else {
+                    for (int x = 0; x < cols; ++x) {
+                        for (int c = 0; c < 3; ++c) {
+                            value[x * 3 + c] = combine(value[x * 3 + c], other[x]);
+                        }
+                    }
+                }
+                break;
+            }
+            }
+            current = channels[s];
+        }
+
+        std::memcpy(output.ptr<uchar>(y), value.data(), static_cast<size_t>(cols) * current);
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "PointwiseOp.hpp"
+
+// Runs a chain of PointwiseOps in one pass: each row of the input (and of every Combine
+// operand) is read once, pushed through all stages in a row-sized scratch buffer that stays
+// in L1, and written once. Rows are split across cv::parallel_for_.
+class PointwiseChain {
+public:
+    // `other` is the Combine operand that does not come from the previous stage;
+    // `chainIsA` says which side of the Combine the running value is on.
+    void addStage(const PointwiseOp& op, const cv::Mat& other = cv::Mat(), bool chainIsA = true);
+
+    // True when every image is 8-bit, sizes agree and the channel counts are ones the
+    // nodes themselves accept (equal, or one side gray and the other BGR for a Combine).
+    bool accepts(const cv::Mat& input) const;
+
+    void run(const cv::Mat& input, cv::Mat& output) const;
+
+    size_t size() const { return stages.size(); }
+
+private:
+    struct Stage {
+        PointwiseOp op;
+        cv::Mat other;
+        bool chainIsA;
+    };
+
+    // Channel count after each stage, or an empty vector if the chain cannot run on `input`.
+    std::vector<int> channelFlow(const cv::Mat& input) const;
+
+    void runRows(const cv::Mat& input, cv::Mat& output, const std::vector<int>& channels, int begin, int end) const;
+
+    std::vector<Stage> stages;
+};
@@ -0,0 +1,18 @@
+#pragma once
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// What a per-pixel node does to one 8-bit pixel, as a lookup table. Nodes that can describe
+// themselves this way report it from Node::getPointwiseOp(), and NodeGraph fuses chains of
+// them into a single pass over memory (see PointwiseChain). The tables are built by running
+// the node's own OpenCV code on every possible input, so the fused result is bit-exact.
+struct PointwiseOp {
+    enum class Kind {
+        Map,      // out[c] = table[in[c]] on every channel
+        GrayMap,  // out = table[gray], gray as cv::COLOR_BGR2GRAY computes it; single-channel out
+        Combine   // out[c] = table[a[c] * 256 + b[c]], a and b from the node's first two input ports
+    };
+
+    Kind kind = Kind::Map;
+    std::vector<uchar> table;  // 256 entries, or 256 * 256 for Combine
+};
@@ -0,0 +1,254 @@
+#include "Profiler.hpp"
+#include "Log.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace {
+
+thread_local size_t threadAllocations = 0;
+thread_local size_t threadAllocatedBytes = 0;
+thread_local size_t threadPoolReuses = 0;
+
+// Forwards to the wrapped allocator and counts on the calling thread. The buffers it hands out
+// belong to the wrapped allocator, so they are freed correctly after counting stops.
+class CountingAllocator : public cv::MatAllocator {
+public:
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override {
+        cv::UMatData* u = wrapped->allocate(dims, sizes, type, data, step, flags, usageFlags);
+        if (u && !data) {
+            ++threadAllocations;
+            threadAllocatedBytes += u->size;
+        }
+        return u;
+    }
+
+    bool allocate(cv::UMatData* data, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const override {
+        return wrapped->allocate(data, accessFlags, usageFlags);
+    }
+
+    void deallocate(cv::UMatData* data) const override {
+        wrapped->deallocate(data);
+    }
+
+    cv::MatAllocator* wrapped = nullptr;
+};
+
+CountingAllocator& countingAllocator() {
+    // Intentionally leaked: OpenCV may still reach it during static destruction.
+    static CountingAllocator* allocator = new CountingAllocator();
+    return *allocator;
+}
+
+// Runs on several threads (e.g. a batch encoder and a graph) may overlap and end in any order,
+// so the counting allocator stays installed until the last of them is done.
+std::mutex countingMutex;
+int countingUsers = 0;
+std::atomic<bool> countingActive{false};  // countingUsers > 0, readable without the mutex
+
+double threadCpuMicros() {
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &created, &exited, &kernel, &user)) {
+        return 0;
+    }
+    auto ticks = [](const FILETIME& time) {
+        return (static_cast<unsigned long long>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+    return (ticks(kernel) + ticks(user)) / 10.0;  // 100 ns units
+#else
+    timespec now;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) != 0) {
+        return 0;
+    }
+    return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+#endif
+}
+
+size_t threadNumber() {
+    static std::atomic<size_t> next{0};
+    thread_local size_t number = next++;
+    return number;
+}
+
+std::string escapeJson(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        switch (c) {
+        case '"': escaped += "\\\""; break;
+        case '\\': escaped += "\\\\"; break;
+        case '\n': escaped += "\\n"; break;
+        case '\t': escaped += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char code[8];
+                std::snprintf(code, sizeof(code), "\\u%04x", c);
+                escaped += code;
+            } else {
+                escaped += c;
+            }
+        }
+    }
+    return escaped;
+}
+
+}
+
+Profiler::AllocationCounting::AllocationCounting() {
+    std::lock_guard<std::mutex> lock(countingMutex);
+    if (countingUsers++ == 0) {
+        CountingAllocator& counting = countingAllocator();
+        counting.wrapped = cv::Mat::getDefaultAllocator();
+        cv::Mat::setDefaultAllocator(&counting);
+        countingActive = true;
+    }
+}
+
+Profiler::AllocationCounting::~AllocationCounting() {
+    std::lock_guard<std::mutex> lock(countingMutex);
+    if (--countingUsers == 0) {
+        countingActive = false;
+        cv::Mat::setDefaultAllocator(countingAllocator().wrapped);
+    }
+}
+
+Profiler::Profiler() : origin(std::chrono::steady_clock::now()) {}
+
+Profiler::Sample Profiler::sample() {
+    Sample now;
+    now.wall = std::chrono::steady_clock::now();
+    now.cpuUs = threadCpuMicros();
+    now.allocations = threadAllocations;
+    now.allocatedBytes = threadAllocatedBytes;
+    now.poolReuses = threadPoolReuses;
+    return now;
+}
+
+void Profiler::countAllocation(size_t bytes) {
+    if (countingActive.load(std::memory_order_relaxed)) {
+        ++threadAllocations;
+        threadAllocatedBytes += bytes;
+    }
+}
+
+void Profiler::countPoolReuse() {
+    if (countingActive.load(std::memory_order_relaxed)) {
+        ++threadPoolReuses;
+    }
+}
+
+void Profiler::record(const std::string& name, const std::string& id, const Sample& begin,
+                      size_t bytesRead, size_t bytesWritten) {
+    Sample end = sample();
+
+    Record entry;
+    entry.name = name;
+    entry.id = id;
+    entry.thread = threadNumber();
+    entry.startUs = std::chrono::duration<double, std::micro>(begin.wall - origin).count();
+    entry.wallUs = std::chrono::duration<double, std::micro>(end.wall - begin.wall).count();
+    entry.cpuUs = end.cpuUs - begin.cpuUs;
+    entry.bytesRead = bytesRead;
+    entry.bytesWritten = bytesWritten;
+    entry.allocations = end.allocations - begin.allocations;
+    entry.allocatedBytes = end.allocatedBytes - begin.allocatedBytes;
+    entry.poolReuses = end.poolReuses - begin.poolReuses;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    records.push_back(std::move(entry));
+}
+
+std::vector<Profiler::Record> Profiler::getRecords() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return records;
+}
+
+void Profiler::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    records.clear();
+}
+
+bool Profiler::writeChromeTrace(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file) {
+        LOG_ERROR("Profiler", "cannot write trace path=" << path);
+        return false;
+    }
+
+    std::vector<Record> snapshot = getRecords();
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+        const Record& r = snapshot[i];
+        file << (i ? ",\n" : "\n")
+             << "{\"name\":\"" << escapeJson(r.name) << "\",\"cat\":\"node\",\"ph\":\"X\""
+             << ",\"ts\":" << r.startUs << ",\"dur\":" << r.wallUs
+             << ",\"pid\":1,\"tid\":" << r.thread
+             << ",\"args\":{\"id\":\"" << escapeJson(r.id) << "\""
+             << ",\"cpu_us\":" << r.cpuUs
+             << ",\"bytes_read\":" << r.bytesRead
+             << ",\"bytes_written\":" << r.bytesWritten
+             << ",\"allocations\":" << r.allocations
+             << ",\"allocated_bytes\":" << r.allocatedBytes
+             << ",\"pool_reuses\":" << r.poolReuses << "}}";
+    }
+    file << "\n]}\n";
+    return static_cast<bool>(file);
+}
+
+void Profiler::printSummary(std::ostream& out) const {
+    struct Total {
+        size_t count = 0;
+        double wallUs = 0;
+        double cpuUs = 0;
+        size_t bytes = 0;
+        size_t allocations = 0;
+        size_t poolReuses = 0;
+    };
+
+    std::map<std::string, Total> totals;
+    double allWallUs = 0;
+    for (const Record& r : getRecords()) {
+        Total& total = totals[r.name];
+        ++total.count;
+        total.wallUs += r.wallUs;
+        total.cpuUs += r.cpuUs;
+        total.bytes += r.bytesRead + r.bytesWritten;
+        total.allocations += r.allocations;
+        total.poolReuses += r.poolReuses;
+        allWallUs += r.wallUs;
+    }
+
+    std::vector<std::pair<std::string, Total>> sorted(totals.begin(), totals.end());
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second.wallUs > b.second.wallUs; });
+
+    out << std::fixed << std::setprecision(2);
+    out << "Node profile (" << sorted.size() << " nodes):\n";
+    for (const auto& entry : sorted) {
+        const Total& t = entry.second;
+        out << "  " << std::setw(24) << std::left << entry.first << std::right
+            << std::setw(10) << t.wallUs / 1000.0 << " ms wall"
+            << std::setw(10) << t.cpuUs / 1000.0 << " ms cpu"
+            << std::setw(7) << (allWallUs > 0 ? 100.0 * t.wallUs / allWallUs : 0.0) << " %"
+            << std::setw(10) << t.bytes / (1024.0 * 1024.0) << " MB"
+            << std::setw(6) << t.allocations << " allocs"
+            << std::setw(6) << t.poolReuses << " reused"
+            << "  x" << t.count << "\n";
+    }
+    out << std::defaultfloat;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// Collects one record per node evaluation: wall time, CPU time of the evaluating thread,
+// pixel bytes read and written and the Mat allocations made meanwhile. Records accumulate
+// across runs until clear(), and can be written as Chrome trace-event JSON, which
+// chrome://tracing and ui.perfetto.dev open directly. Safe to record from several workers.
+class Profiler {
+public:
+    struct Record {
+        std::string name;         // Node name, or the names of a fused chain joined by " + "
+        std::string id;           // Node id
+        size_t thread = 0;        // Small per-thread number, 0 for the first thread that recorded
+        double startUs = 0;       // Since the profiler was created
+        double wallUs = 0;
+        double cpuUs = 0;         // Evaluating thread only; OpenCV's own worker threads are not included
+        size_t bytesRead = 0;
+        size_t bytesWritten = 0;
+        size_t allocations = 0;   // Evaluating thread only, like cpuUs
+        size_t allocatedBytes = 0;
+        size_t poolReuses = 0;    // Outputs served from the graph's buffer pool without allocating
+    };
+
+    // State of the calling thread's clocks and allocation counters at one point in time.
+    struct Sample {
+        std::chrono::steady_clock::time_point wall;
+        double cpuUs = 0;
+        size_t allocations = 0;
+        size_t allocatedBytes = 0;
+        size_t poolReuses = 0;
+    };
+
+    // Counts cv::Mat allocations while it is alive, by wrapping OpenCV's default allocator.
+    // Each thread counts its own, in the counters sample() reads, so a record only includes
+    // what the evaluating thread allocated: buffers allocated by OpenCV's worker threads inside
+    // a parallel loop are not attributed to any node. Instances may overlap: the wrapper is
+    // installed by the first and removed by the last. Mats given an allocator explicitly bypass
+    // it; the graph's buffer pool reports its own heap allocations through countAllocation()
+    // instead, so a node's count means the same with the pool on or off.
+    class AllocationCounting {
+    public:
+        AllocationCounting();
+        ~AllocationCounting();
+
+        AllocationCounting(const AllocationCounting&) = delete;
+        AllocationCounting& operator=(const AllocationCounting&) = delete;
+    };
+
+    Profiler();
+
+    static Sample sample();
+
+    // Counts an allocation made by a custom allocator on the calling thread, or a buffer it
+    // reused instead. Does nothing unless an AllocationCounting is alive.
+    static void countAllocation(size_t bytes);
+    static void countPoolReuse();
+
+    // Adds a record spanning from `begin` to now on the calling thread.
+    void record(const std::string& name, const std::string& id, const Sample& begin,
+                size_t bytesRead, size_t bytesWritten);
+
+    std::vector<Record> getRecords() const;
+    void clear();
+
+    // Writes every record as a complete ("X") event; returns false if the file cannot be written.
+    bool writeChromeTrace(const std::string& path) const;
+
+    // Per-node totals, most expensive first.
+    void printSummary(std::ostream& out) const;
+
+private:
+    std::chrono::steady_clock::time_point origin;
+    std::vector<Record> records;
+    mutable std::mutex mutex;
+};
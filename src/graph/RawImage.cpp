@@ -0,0 +1,235 @@
+#include "RawImage.hpp"
+#include "Log.hpp"
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char rawMagic[4] = {'N', 'G', 'R', 'I'};
+const uint32_t rawVersion = 1;
+const uint64_t payloadOffset = 4096;
+
+struct RawHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t step;
+    uint64_t offset;
+    uint64_t bytes;
+};
+
+// One mapped file: the view's base address and length, plus the handles Windows needs.
+struct Mapping {
+    void* base = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE section = nullptr;
+#endif
+};
+
+void unmapFile(Mapping* mapping) {
+#ifdef _WIN32
+    if (mapping->base) UnmapViewOfFile(mapping->base);
+    if (mapping->section) CloseHandle(mapping->section);
+    if (mapping->file != INVALID_HANDLE_VALUE) CloseHandle(mapping->file);
+#else
+    if (mapping->base) munmap(mapping->base, mapping->length);
+#endif
+    delete mapping;
+}
+
+// Maps the whole file copy-on-write; nullptr on failure.
+Mapping* mapFile(const std::string& path) {
+    auto* mapping = new Mapping();
+#ifdef _WIN32
+    // FILE_SHARE_DELETE lets writeRawImage() rename a new version over the file while mapped
+    mapping->file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER size;
+    if (mapping->file == INVALID_HANDLE_VALUE || !GetFileSizeEx(mapping->file, &size)) {
+        unmapFile(mapping);
+        return nullptr;
+    }
+    mapping->length = static_cast<size_t>(size.QuadPart);
+    mapping->section = CreateFileMappingA(mapping->file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    if (mapping->section) {
+        mapping->base = MapViewOfFile(mapping->section, FILE_MAP_COPY, 0, 0, 0);
+    }
+    if (!mapping->base) {
+        unmapFile(mapping);
+        return nullptr;
+    }
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        delete mapping;
+        return nullptr;
+    }
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        mapping->length = static_cast<size_t>(info.st_size);
+        void* base = mmap(nullptr, mapping->length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        mapping->base = base == MAP_FAILED ? nullptr : base;
+    }
+    close(fd);  // The mapping keeps the file open
+    if (!mapping->base) {
+        delete mapping;
+        return nullptr;
+    }
+#endif
+    return mapping;
+}
+
+// Owns the UMatData of Mats created by mapRawImage(): never allocates, and unmaps the file
+// once the last Mat sharing the payload is released.
+class MappedAllocator : public cv::MatAllocator {
+public:
+    cv::UMatData* allocate(int, const int*, int, void*, size_t*, cv::AccessFlag, cv::UMatUsageFlags) const override {
+        return nullptr;
+    }
+
+    bool allocate(cv::UMatData*, cv::AccessFlag, cv::UMatUsageFlags) const override {
+        return false;
+    }
+
+    void deallocate(cv::UMatData* u) const override {
+        if (!u) {
+            return;
+        }
+        CV_Assert(u->urefcount == 0);
+        CV_Assert(u->refcount == 0);
+        unmapFile(static_cast<Mapping*>(u->userdata));
+        delete u;
+    }
+};
+
+MappedAllocator& mappedAllocator() {
+    // Intentionally leaked, like BufferPool: mapped Mats may outlive static destruction.
+    static MappedAllocator* allocator = new MappedAllocator();
+    return *allocator;
+}
+
+}
+
+bool isRawImagePath(const std::string& path) {
+    const std::string extension = ".ngraw";
+    return path.size() >= extension.size() &&
+           path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+cv::Mat mapRawImage(const std::string& path) {
+    Mapping* mapping = mapFile(path);
+    if (!mapping) {
+        LOG_ERROR("RawImage", "cannot map path=" << path);
+        return cv::Mat();
+    }
+
+    RawHeader header;
+    bool valid = mapping->length >= sizeof(header);
+    if (valid) {
+        std::memcpy(&header, mapping->base, sizeof(header));
+        size_t elementBytes = CV_ELEM_SIZE(header.type);
+        valid = std::memcmp(header.magic, rawMagic, sizeof(rawMagic)) == 0 && header.version == rawVersion &&
+                CV_MAT_DEPTH(header.type) <= CV_64F && header.rows > 0 && header.cols > 0 &&
+                header.rows <= INT_MAX && header.cols <= INT_MAX &&
+                header.step >= header.cols * elementBytes && header.bytes == header.step * header.rows &&
+                header.offset >= sizeof(header) && header.offset + header.bytes <= mapping->length;
+    }
+    if (!valid) {
+        LOG_ERROR("RawImage", "not a raw image path=" << path);
+        unmapFile(mapping);
+        return cv::Mat();
+    }
+
+    uchar* pixels = static_cast<uchar*>(mapping->base) + header.offset;
+    cv::Mat image(static_cast<int>(header.rows), static_cast<int>(header.cols), static_cast<int>(header.type),
+                  pixels, static_cast<size_t>(header.step));
+
+    // Hand ownership of the mapping to the Mat, as if the allocator had made the buffer
+    cv::UMatData* u = new cv::UMatData(&mappedAllocator());
+    u->data = u->origdata = pixels;
+    u->size = header.bytes;
+    u->userdata = mapping;
+    u->refcount = 1;
+    image.u = u;
+    image.allocator = &mappedAllocator();
+    return image;
+}
+
+bool writeRawImage(const std::string& path, const cv::Mat& image) {
+    if (image.empty() || image.dims != 2) {
+        LOG_ERROR("RawImage", "cannot write an empty or multi-dimensional image path=" << path);
+        return false;
+    }
+
+    const size_t rowBytes = image.cols * image.elemSize();
+    RawHeader header = {};
+    std::memcpy(header.magic, rawMagic, sizeof(rawMagic));
+    header.version = rawVersion;
+    header.rows = static_cast<uint32_t>(image.rows);
+    header.cols = static_cast<uint32_t>(image.cols);
+    header.type = static_cast<uint32_t>(image.type());
+    header.step = rowBytes;
+    header.offset = payloadOffset;
+    header.bytes = rowBytes * image.rows;
+
+    // Written next to the target and renamed over it: Mats mapped from an older version of the
+    // file keep that version, instead of seeing pages change under them (or SIGBUS on a
+    // shorter file) as they would if it were truncated and rewritten in place
+    const std::string temporaryPath = path + ".tmp";
+    std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        LOG_ERROR("RawImage", "cannot write path=" << temporaryPath);
+        return false;
+    }
+
+    char block[payloadOffset] = {};
+    std::memcpy(block, &header, sizeof(header));
+    file.write(block, sizeof(block));
+    if (image.isContinuous()) {
+        file.write(reinterpret_cast<const char*>(image.data), static_cast<std::streamsize>(header.bytes));
+    } else {
+        for (int y = 0; y < image.rows; ++y) {
+            file.write(reinterpret_cast<const char*>(image.ptr(y)), static_cast<std::streamsize>(rowBytes));
+        }
+    }
+    file.close();
+    std::error_code error;
+    if (!file) {
+        LOG_ERROR("RawImage", "write failed path=" << temporaryPath);
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error) {
+        LOG_ERROR("RawImage", "cannot replace path=" << path << " error=" << error.message());
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+    return true;
+}
+
+cv::Mat readImage(const std::string& path, int flags) {
+    return isRawImagePath(path) ? mapRawImage(path) : cv::imread(path, flags);
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+#include <opencv2/opencv.hpp>
+
+// Uncompressed image files (".ngraw") for handing images between pipeline stages without
+// codec work. A 4 KiB header is followed by the pixels exactly as a continuous cv::Mat
+// holds them, so the payload starts page-aligned:
+//
+//   offset 0   "NGRI"
+//          4   u32 version (1)
+//          8   u32 rows, u32 cols, u32 cv type, u32 reserved
+//         24   u64 row step in bytes, u64 payload offset (4096), u64 payload bytes
+//
+// Fields are in native byte order; files are meant for the machine that wrote them.
+
+// True for paths with the ".ngraw" extension.
+bool isRawImagePath(const std::string& path);
+
+// Maps the file into memory and returns a cv::Mat over the mapped payload; no pixel is read or
+// copied until it is used. The mapping is private copy-on-write, so writing to the Mat never
+// changes the file, and it is unmapped when the last Mat referring to it is released.
+// Returns an empty Mat if the file is missing or not a valid raw image.
+cv::Mat mapRawImage(const std::string& path);
+
+// Writes the header and the payload, the latter with a single write for continuous images.
+// The file is written under a temporary name and renamed over `path`, so images already
+// mapped from `path` are left intact. Windows may still refuse to replace a file while a view
+// of it is mapped; the write then fails and the old file is kept.
+bool writeRawImage(const std::string& path, const cv::Mat& image);
+
+// cv::imread(), except that raw images are mapped instead of decoded; `flags` only applies to
+// encoded files, raw ones come back exactly as they were written.
+cv::Mat readImage(const std::string& path, int flags = cv::IMREAD_COLOR);
@@ -0,0 +1,113 @@
+#include "ThreadPool.hpp"
+#include "Log.hpp"
+#include <exception>
+
+namespace {
+// Index of the pool worker running on this thread, or -1 for outside threads.
+thread_local long currentWorker = -1;
+thread_local const ThreadPool* currentPool = nullptr;
+}
+
+ThreadPool::ThreadPool(size_t workerCount) {
+    if (workerCount == 0) {
+        workerCount = 1;
+    }
+    for (size_t i = 0; i < workerCount; ++i) {
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    size_t target = (currentPool == this && currentWorker >= 0)
+                        ? static_cast<size_t>(currentWorker)
+                        : nextQueue.fetch_add(1) % queues.size();
+
+    pendingTasks.fetch_add(1);
+    {
+        // Counted in the same critical section that publishes the task, so the worker that
+        // takes it cannot decrement queuedTasks before it was incremented
+        std::lock_guard<std::mutex> stateLock(stateMutex);
+        std::lock_guard<std::mutex> lock(queues[target]->mutex);
+        queues[target]->tasks.push_back(std::move(task));
+        ++queuedTasks;
+    }
+    workAvailable.notify_one();
+}
+
+void ThreadPool::waitIdle() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    allDone.wait(lock, [this] { return pendingTasks.load() == 0; });
+}
+
+bool ThreadPool::popLocal(size_t index, std::function<void()>& task) {
+    WorkQueue& queue = *queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(size_t thief, std::function<void()>& task) {
+    for (size_t offset = 1; offset < queues.size(); ++offset) {
+        WorkQueue& victim = *queues[(thief + offset) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    currentWorker = static_cast<long>(index);
+    currentPool = this;
+
+    while (true) {
+        std::function<void()> task;
+        if (popLocal(index, task) || steal(index, task)) {
+            {
+                std::lock_guard<std::mutex> lock(stateMutex);
+                --queuedTasks;
+            }
+            // Callers that need a task's failure catch it themselves; an escaping exception
+            // would otherwise terminate the process from a worker thread
+            try {
+                task();
+            } catch (const std::exception& e) {
+                LOG_ERROR("ThreadPool", "task threw worker=" << index << " error=" << e.what());
+            } catch (...) {
+                LOG_ERROR("ThreadPool", "task threw worker=" << index);
+            }
+            if (pendingTasks.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(stateMutex);
+                allDone.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(stateMutex);
+        workAvailable.wait(lock, [this] { return stopping || queuedTasks > 0; });
+        if (stopping && queuedTasks == 0) {
+            return;
+        }
+    }
+}
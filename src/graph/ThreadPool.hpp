@@ -0,0 +1,50 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size work-stealing thread pool.
+// Every worker owns a deque: it pushes and pops its own work at the back (LIFO, cache friendly)
+// and steals from the front of other workers' deques (FIFO) when it runs dry.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t workerCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queues a task. Tasks submitted from a worker go to that worker's own deque.
+    void submit(std::function<void()> task);
+
+    // Blocks until every submitted task (including tasks they submitted) has finished.
+    void waitIdle();
+
+    size_t size() const { return workers.size(); }
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void workerLoop(size_t index);
+    bool popLocal(size_t index, std::function<void()>& task);
+    bool steal(size_t thief, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex stateMutex;
+    std::condition_variable workAvailable;
+    std::condition_variable allDone;
+    size_t queuedTasks = 0;            // Tasks sitting in a deque, guarded by stateMutex
+    std::atomic<size_t> pendingTasks{0};  // Tasks queued or running
+    std::atomic<size_t> nextQueue{0};     // Round-robin target for external submits
+    bool stopping = false;
+};
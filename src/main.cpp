@@ -854,10 +854,11 @@ void convolutionfilter(std::shared_ptr<ConvolutionFilterNode> &convoNode, cv::Ma
     case 4:
     {
         int kernelSize;
-        std::cout << "Enter kernel size (3 or 5): "; // Ask for custom kernel size
+        std::cout << "Enter kernel size (odd, e.g. 3, 5 or 31): "; // Ask for custom kernel size
         std::cin >> kernelSize; // Get the kernel size from user
-        if (kernelSize == 3 || kernelSize == 5) // Check if the kernel size is valid (3x3 or 5x5)
+        if (kernelSize >= 1 && kernelSize % 2 == 1) // Check if the kernel size is valid (odd, so it has a centre)
         {
+            convoNode->setKernelSize(kernelSize); // Resize the kernel before filling it
             std::vector<float> customKernel(kernelSize * kernelSize); // Create a vector to store custom kernel values
             std::cout << "Enter the values for the " << kernelSize << "x" << kernelSize << " kernel:\n";
             
@@ -1,7 +1,7 @@
 #include "BlendNode.hpp"
+#include "../graph/Log.hpp"
 #include <opencv2/opencv.hpp>
 #include <imgui.h>
-#include <iostream>
 
 // Constructor for BlendNode, initializing the node with a name and generating a unique ID.
 BlendNode::BlendNode(const std::string &name)
@@ -10,30 +10,100 @@ BlendNode::BlendNode(const std::string &name)
     this->id = "blend_node_" + name; // Generate a unique ID for the node
 }
 
-// Sets the first input image (inputA) by cloning the provided image.
+// Sets the first input image (inputA). Only the header is copied; the blend never writes to its inputs.
 void BlendNode::setInputA(const cv::Mat &image)
 {
-    inputA = image.clone();
+    inputA = image;
+    markDirty();
 }
 
-// Sets the second input image (inputB) by cloning the provided image.
+// Sets the second input image (inputB). Only the header is copied; the blend never writes to its inputs.
 void BlendNode::setInputB(const cv::Mat &image)
 {
-    inputB = image.clone();
+    inputB = image;
+    markDirty();
 }
 
-// Sets the blending mode and triggers the process to apply the blending operation.
+// The blend takes its base image on port "a" and the layer blended on top of it on port "b".
+std::vector<Node::Port> BlendNode::getInputPorts() const
+{
+    return {{"a", PortType::Image}, {"b", PortType::Image}};
+}
+
+// Routes a graph connection to the matching input.
+void BlendNode::setInputPort(const std::string &port, const cv::Mat &value)
+{
+    if (port == "a")
+    {
+        setInputA(value);
+    }
+    else if (port == "b")
+    {
+        setInputB(value);
+    }
+    else
+    {
+        LOG_ERROR("Blend", "unknown input port node=" << name << " port=" << port);
+    }
+}
+
+// Sets the blending mode and marks the node stale so the graph reapplies the blend.
 void BlendNode::setBlendMode(BlendMode mode)
 {
     blendMode = mode;
-    process(); // Recalculate the output based on the new blend mode
+    markDirty(); // Output is recomputed with the new blend mode on the next graph run
 }
 
-// Sets the opacity for the blend, clamping the value between 0.0 and 1.0, and triggers reprocessing.
+// Sets the opacity for the blend, clamping the value between 0.0 and 1.0, and marks the node stale.
 void BlendNode::setOpacity(float value)
 {
     opacity = std::clamp(value, 0.0f, 1.0f); // Ensure opacity is within the range [0.0, 1.0]
-    process();                               // Recalculate the blend with the updated opacity
+    markDirty();                             // Output is recomputed with the updated opacity on the next graph run
+}
+
+// Parameters that determine the blended output.
+ParamMap BlendNode::getParams() const
+{
+    return {{"mode", toParam(static_cast<int>(blendMode))}, {"opacity", toParam(opacity)}};
+}
+
+// Graph files refer to this node as "Blend".
+std::string BlendNode::getType() const
+{
+    return "Blend";
+}
+
+std::shared_ptr<Node> BlendNode::clone() const
+{
+    return std::make_shared<BlendNode>(*this);
+}
+
+// Restores the blend mode and opacity saved by getParams().
+void BlendNode::applyParams(const ParamMap &params)
+{
+    int mode = static_cast<int>(blendMode);
+    if (readParam(params, "mode", mode) && mode >= NORMAL && mode <= DIFFERENCE)
+    {
+        blendMode = static_cast<BlendMode>(mode);
+    }
+    float value = opacity;
+    if (readParam(params, "opacity", value))
+    {
+        opacity = std::clamp(value, 0.0f, 1.0f); // Same range setOpacity() enforces
+    }
+    markDirty();
+}
+
+void BlendNode::releaseOutputs()
+{
+    outputImage.release();
+}
+
+// Releases both inputs so their buffers return to the pool.
+void BlendNode::releaseInputs()
+{
+    inputA.release();
+    inputB.release();
 }
 
 // Returns the final blended output image.
@@ -48,18 +118,59 @@ void BlendNode::process()
     // If either input image is empty, output an error and stop processing
     if (inputA.empty() || inputB.empty())
     {
-        std::cerr << "One or both input images are empty in BlendNode: " << name << std::endl;
+        LOG_WARN("Blend", "missing input node=" << name);
         return;
     }
 
-    // Resize the second image (inputB) to match the size of inputA
-    cv::Mat resizedB;
-    cv::resize(inputB, resizedB, inputA.size()); // Resize to ensure the images have the same size
+    useOutputAllocator(outputImage); // Let the graph's buffer pool provide the result
+
+    // Resize the second image (inputB) to match the size of inputA, skipping the copy when it already does
+    cv::Mat resizedB = inputB.read();
+    if (inputB.read().size() != inputA.read().size())
+    {
+        cv::resize(inputB.read(), resizedB, inputA.read().size()); // Resize to ensure the images have the same size
+    }
+
+    // Promote a single-channel input (e.g. a mask from ThresholdNode) so both sides have the same channel count
+    cv::Mat baseA = inputA.read();
+    if (baseA.channels() == 1 && resizedB.channels() == 3)
+    {
+        cv::cvtColor(baseA, baseA, cv::COLOR_GRAY2BGR);
+    }
+    else if (resizedB.channels() == 1 && baseA.channels() == 3)
+    {
+        cv::cvtColor(resizedB, resizedB, cv::COLOR_GRAY2BGR);
+    }
+
+    blend(baseA, resizedB, outputImage);
+}
 
+// Describes the blend as a table indexed by (a, b), built by blending a 256 x 256 grid of every value pair.
+bool BlendNode::getPointwiseOp(PointwiseOp &op) const
+{
+    cv::Mat gridA(256, 256, CV_8U), gridB(256, 256, CV_8U), blended;
+    for (int a = 0; a < 256; a++)
+    {
+        for (int b = 0; b < 256; b++)
+        {
+            gridA.at<uchar>(a, b) = static_cast<uchar>(a); // Row index is the value from port "a"
+            gridB.at<uchar>(a, b) = static_cast<uchar>(b); // Column index is the value from port "b"
+        }
+    }
+    blend(gridA, gridB, blended);
+
+    op.kind = PointwiseOp::Kind::Combine;
+    op.table.assign(blended.ptr<uchar>(0), blended.ptr<uchar>(0) + 256 * 256);
+    return true;
+}
+
+// Applies the blend mode and opacity to two images that already match in size and channel count.
+void BlendNode::blend(const cv::Mat &a, const cv::Mat &b, cv::Mat &output) const
+{
     // Convert the input images to floating-point values for precise blending operations
     cv::Mat blendA, blendB;
-    inputA.convertTo(blendA, CV_32F, 1.0 / 255.0);   // Normalize inputA to [0, 1]
-    resizedB.convertTo(blendB, CV_32F, 1.0 / 255.0); // Normalize inputB to [0, 1]
+    a.convertTo(blendA, CV_32F, 1.0 / 255.0); // Normalize inputA to [0, 1]
+    b.convertTo(blendB, CV_32F, 1.0 / 255.0); // Normalize inputB to [0, 1]
 
     cv::Mat result; // The resulting blended image
 
@@ -77,17 +188,17 @@ void BlendNode::process()
         break;
     case OVERLAY:
         result = cv::Mat(blendA.size(), blendA.type());
-        // Overlay mode: mix based on the brightness of blendA
+        // Overlay mode: mix based on the brightness of blendA, channel by channel whatever the channel count
         for (int y = 0; y < blendA.rows; y++)
         {
-            for (int x = 0; x < blendA.cols; x++)
+            const float *rowA = blendA.ptr<float>(y);
+            const float *rowB = blendB.ptr<float>(y);
+            float *rowResult = result.ptr<float>(y);
+            for (int i = 0; i < blendA.cols * blendA.channels(); i++)
             {
-                for (int c = 0; c < blendA.channels(); c++)
-                {
-                    float a = blendA.at<cv::Vec3f>(y, x)[c];
-                    float b = blendB.at<cv::Vec3f>(y, x)[c];
-                    result.at<cv::Vec3f>(y, x)[c] = (a < 0.5f) ? (2 * a * b) : (1 - 2 * (1 - a) * (1 - b));
-                }
+                float va = rowA[i];
+                float vb = rowB[i];
+                rowResult[i] = (va < 0.5f) ? (2 * va * vb) : (1 - 2 * (1 - va) * (1 - vb));
             }
         }
         break;
@@ -100,7 +211,7 @@ void BlendNode::process()
     result = opacity * result + (1.0f - opacity) * blendA;
 
     // Convert the result back to an 8-bit image for display
-    result.convertTo(outputImage, CV_8U, 255.0); // Convert to 8-bit image in the range [0, 255]
+    result.convertTo(output, CV_8U, 255.0); // Convert to 8-bit image in the range [0, 255]
 }
 
 // Renders the user interface for controlling the blend mode and opacity using ImGui.
@@ -111,12 +222,12 @@ void BlendNode::renderUI()
     // Create a combo box for selecting the blend mode
     if (ImGui::Combo("Blend Mode", reinterpret_cast<int *>(&blendMode), blendNames, IM_ARRAYSIZE(blendNames)))
     {
-        process(); // Reprocess the blend if the mode is changed
+        markDirty(); // Reprocess the blend on the next run if the mode is changed
     }
 
     // Create a slider for adjusting the opacity
     if (ImGui::SliderFloat("Opacity", &opacity, 0.0f, 1.0f))
     {
-        process(); // Reprocess the blend if the opacity is changed
+        markDirty(); // Reprocess the blend on the next run if the opacity is changed
     }
 }
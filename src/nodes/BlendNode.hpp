@@ -1,5 +1,6 @@
 #pragma once
 #include "../graph/Node.hpp"
+#include "../graph/ImageHandle.hpp"
 #include <opencv2/opencv.hpp>
 
 // The BlendNode class applies a blending effect to two input images using various blend modes.
@@ -25,6 +26,12 @@ public:
     // Sets the second input image (inputB) to be used in the blend.
     void setInputB(const cv::Mat &image);
 
+    // Exposes inputA and inputB as the "a" and "b" ports so the graph can wire both inputs.
+    std::vector<Port> getInputPorts() const override;
+
+    // Routes a port value to setInputA or setInputB.
+    void setInputPort(const std::string &port, const cv::Mat &value) override;
+
     // Sets the blend mode to one of the available modes from the enum.
     void setBlendMode(BlendMode mode);
 
@@ -40,12 +47,35 @@ public:
     // Returns the resulting blended image.
     cv::Mat getOutput() const override;
 
+    // Every blend mode is per-pixel, so matching tiles of inputA and inputB can be blended on their own.
+    bool isTileable() const override { return true; }
+
+    // On 8-bit inputs every blend mode maps a pair of channel values to one value, which is
+    // described as a 256 x 256 table so the graph can fuse the blend with its neighbours.
+    bool getPointwiseOp(PointwiseOp &op) const override;
+
+    // Reports blend mode and opacity so the graph can cache the blended output.
+    ParamMap getParams() const override;
+
+    // "Blend" in graph files; applyParams() restores what getParams() reports.
+    std::string getType() const override;
+    void applyParams(const ParamMap &params) override;
+
+    std::shared_ptr<Node> clone() const override;
+    void releaseOutputs() override;
+
+    // Forgets both inputs so their buffers can be recycled once the graph is done with them.
+    void releaseInputs() override;
+
 private:
+    // Blends two images of equal size and channel count with the current mode and opacity.
+    void blend(const cv::Mat &a, const cv::Mat &b, cv::Mat &output) const;
+
     // The first input image (left operand for blending)
-    cv::Mat inputA;
+    ImageHandle inputA;
 
     // The second input image (right operand for blending)
-    cv::Mat inputB;
+    ImageHandle inputB;
 
     // The resulting image after blending
     cv::Mat outputImage;
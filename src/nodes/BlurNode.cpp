@@ -1,11 +1,178 @@
 #include "BlurNode.hpp"
+#include "../graph/Log.hpp"
 #include <opencv2/opencv.hpp>
-#include <iostream>
+#include <algorithm>
 #include <cmath>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
 #include <imgui.h>
 
 #define PI 3.14159265358979323846  // Define Pi for angle calculations
 
+namespace {
+
+// 1D Gaussian kernels already built, shared by every BlurNode; entries are never modified
+std::mutex kernelCacheMutex;
+std::map<std::pair<int, float>, cv::Mat> kernelCache;
+
+// Radii of three box filters whose repeated application approximates a Gaussian of `sigma`
+// (Kovesi, "Fast almost-Gaussian filtering"): the widths are the odd integers around the ideal
+// width, mixed so the variances add up to sigma^2
+std::vector<int> stackedBoxRadii(float sigma) {
+    const int passes = 3;
+    double ideal = std::sqrt(12.0 * sigma * sigma / passes + 1.0);
+    int lower = std::max(1, static_cast<int>(std::floor(ideal)));
+    if (lower % 2 == 0) {
+        --lower;  // Box widths must be odd to stay centred
+    }
+    int upper = lower + 2;
+    int lowerCount = static_cast<int>(std::lround((12.0 * sigma * sigma - passes * lower * lower - 4.0 * passes * lower - 3.0 * passes) /
+                                                  (-4.0 * lower - 4.0)));
+    lowerCount = std::min(passes, std::max(0, lowerCount));
+
+    std::vector<int> radii;
+    for (int i = 0; i < passes; ++i) {
+        radii.push_back(((i < lowerCount ? lower : upper) - 1) / 2);
+    }
+    return radii;
+}
+
+// One box pass down every column of a single-channel float image. Each column keeps a running
+// sum that gains the row entering the window and loses the one leaving it, so the cost per
+// pixel does not depend on the radius. Stripes of columns run in parallel, and the inner loops
+// walk along rows, where the compiler vectorizes them across neighbouring columns.
+void boxColumns(const cv::Mat& src, cv::Mat& dst, int radius) {
+    dst.create(src.size(), CV_32F);
+    const int rows = src.rows;
+    const float scale = 1.0f / (2 * radius + 1);
+    const int stripeWidth = 1024;  // Floats per task: large enough to vectorize, small enough to spread
+    const int stripes = (src.cols + stripeWidth - 1) / stripeWidth;
+
+    cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range& range) {
+        std::vector<float> sums(stripeWidth);
+        for (int stripe = range.start; stripe < range.end; ++stripe) {
+            const int begin = stripe * stripeWidth;
+            const int width = std::min(stripeWidth, src.cols - begin);
+            float* sum = sums.data();
+
+            // Window around row 0, mirrored at the border like the other blur modes
+            std::fill(sum, sum + width, 0.0f);
+            for (int i = -radius; i <= radius; ++i) {
+                const float* in = src.ptr<float>(cv::borderInterpolate(i, rows, cv::BORDER_REFLECT_101)) + begin;
+                for (int x = 0; x < width; ++x) {
+                    sum[x] += in[x];
+                }
+            }
+
+            // Slide the window down one row at a time
+            for (int y = 0; y < rows; ++y) {
+                float* out = dst.ptr<float>(y) + begin;
+                const float* entering = src.ptr<float>(cv::borderInterpolate(y + radius + 1, rows, cv::BORDER_REFLECT_101)) + begin;
+                const float* leaving = src.ptr<float>(cv::borderInterpolate(y - radius, rows, cv::BORDER_REFLECT_101)) + begin;
+                for (int x = 0; x < width; ++x) {
+                    out[x] = sum[x] * scale;
+                    sum[x] += entering[x] - leaving[x];
+                }
+            }
+        }
+    });
+}
+
+// Three stacked box passes along columns, then the same along rows by way of a transpose, so
+// both directions use the cache-friendly column pass
+void stackedBoxBlur(const cv::Mat& input, cv::Mat& output, float sigma) {
+    const std::vector<int> radii = stackedBoxRadii(sigma);
+    const int channels = input.channels();
+
+    auto blurColumns = [&](cv::Mat& image) {
+        cv::Mat current = image.reshape(1);  // Every channel of every column is a column of its own
+        cv::Mat next;
+        for (int radius : radii) {
+            boxColumns(current, next, radius);
+            std::swap(current, next);
+        }
+        image = current.reshape(channels);
+    };
+
+    cv::Mat image, transposed;
+    input.convertTo(image, CV_MAKETYPE(CV_32F, channels));
+    blurColumns(image);
+    cv::transpose(image, transposed);
+    blurColumns(transposed);
+    cv::transpose(transposed, image);
+    image.convertTo(output, input.depth());  // Rounds and saturates back to the input's depth
+}
+
+// One sample of a directional blur: the whole-pixel part of its offset and the bilinear
+// weights of the four pixels around the exact position
+struct LineTap {
+    int x;
+    int y;
+    float topLeft, topRight, bottomLeft, bottomRight;
+};
+
+// 2 * radius + 1 samples one pixel apart along the angle, centred on the output pixel, with
+// weights that sum to 1 over all taps
+std::vector<LineTap> lineTaps(int radius, float angleDegrees) {
+    const double angleRad = angleDegrees * PI / 180.0;
+    const double dx = std::cos(angleRad);
+    const double dy = std::sin(angleRad);
+    const float scale = 1.0f / (2 * radius + 1);
+
+    std::vector<LineTap> taps;
+    for (int i = -radius; i <= radius; ++i) {
+        double x = i * dx;
+        double y = i * dy;
+        LineTap tap;
+        tap.x = static_cast<int>(std::floor(x));
+        tap.y = static_cast<int>(std::floor(y));
+        float fx = static_cast<float>(x - tap.x);
+        float fy = static_cast<float>(y - tap.y);
+        tap.topLeft = (1 - fx) * (1 - fy) * scale;
+        tap.topRight = fx * (1 - fy) * scale;
+        tap.bottomLeft = (1 - fx) * fy * scale;
+        tap.bottomRight = fx * fy * scale;
+        taps.push_back(tap);
+    }
+    return taps;
+}
+
+// Directional blur as the mean of the image shifted to every tap: O(radius) per pixel, where a
+// dense (2r+1)^2 kernel costs O(radius^2) for the same 2r+1 samples. Bilinear taps keep lines at
+// non-axis angles smooth. Rows run in parallel; the loop along a row vectorizes.
+void lineBlur(const cv::Mat& input, cv::Mat& output, int radius, float angleDegrees) {
+    const std::vector<LineTap> taps = lineTaps(radius, angleDegrees);
+    const int channels = input.channels();
+    const int pad = radius + 1;  // Taps reach `radius` pixels away, plus one for the bilinear neighbour
+
+    // Pad once, mirrored like the other blur modes, so the inner loop needs no bounds checks
+    cv::Mat image, padded;
+    input.convertTo(image, CV_MAKETYPE(CV_32F, channels));
+    cv::copyMakeBorder(image, padded, pad, pad, pad, pad, cv::BORDER_REFLECT_101);
+
+    cv::Mat result(input.size(), CV_MAKETYPE(CV_32F, channels));
+    const int width = input.cols * channels;
+    cv::parallel_for_(cv::Range(0, input.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            float* out = result.ptr<float>(y);
+            std::fill(out, out + width, 0.0f);
+            for (const LineTap& tap : taps) {
+                const float* top = padded.ptr<float>(y + pad + tap.y) + (pad + tap.x) * channels;
+                const float* bottom = padded.ptr<float>(y + pad + tap.y + 1) + (pad + tap.x) * channels;
+                for (int k = 0; k < width; ++k) {
+                    out[k] += tap.topLeft * top[k] + tap.topRight * top[k + channels] +
+                              tap.bottomLeft * bottom[k] + tap.bottomRight * bottom[k + channels];
+                }
+            }
+        }
+    });
+    result.convertTo(output, input.depth());  // Rounds and saturates back to the input's depth
+}
+
+}
+
 // Constructor to initialize the BlurNode with a name and unique ID
 BlurNode::BlurNode(const std::string& name) {
     this->name = name;
@@ -15,36 +182,29 @@ BlurNode::BlurNode(const std::string& name) {
 // Set the input image for the BlurNode
 void BlurNode::setInput(const cv::Mat& input) {
     inputImage = input;  // Store the input image for processing
+    markDirty();         // A new input always needs a new blur
 }
 
-// Generate a directional kernel based on a given radius and angle in degrees
+// Generate a directional kernel based on a given radius and angle in degrees, with every tap
+// spread bilinearly over its four nearest cells; used for the kernel preview
 cv::Mat BlurNode::generateDirectionalKernel(int radius, float angleDegrees) {
     int size = radius * 2 + 1;  // The size of the kernel is based on the radius
     cv::Mat kernel = cv::Mat::zeros(size, size, CV_32F);  // Create a kernel filled with zeros
 
-    // Convert the angle from degrees to radians
-    float angleRad = angleDegrees * PI / 180.0f;
-    float dx = cos(angleRad);  // Calculate the directional x offset based on the angle
-    float dy = sin(angleRad);  // Calculate the directional y offset based on the angle
-
-    // Normalize the directional vector
-    float length = std::sqrt(dx * dx + dy * dy);
-    dx /= length;
-    dy /= length;
-
     float sum = 0.0f;
-    // Generate the kernel by stepping in the direction of the angle
-    for (int i = -radius; i <= radius; ++i) {
-        float x = radius + i * dx;  // Calculate the x position for each step
-        float y = radius + i * dy;  // Calculate the y position for each step
-
-        int ix = static_cast<int>(std::round(x));  // Round the calculated positions to nearest integers
-        int iy = static_cast<int>(std::round(y));
-
-        // Only set kernel values inside the valid bounds of the kernel
-        if (ix >= 0 && ix < size && iy >= 0 && iy < size) {
-            kernel.at<float>(iy, ix) = 1.0f;  // Set the kernel value at the computed position
-            sum += 1.0f;  // Track the sum of all kernel values
+    // Place each tap of the line around the kernel centre
+    for (const LineTap& tap : lineTaps(radius, angleDegrees)) {
+        const int x = radius + tap.x;
+        const int y = radius + tap.y;
+        const float weights[4] = {tap.topLeft, tap.topRight, tap.bottomLeft, tap.bottomRight};
+        for (int corner = 0; corner < 4; ++corner) {
+            int cx = x + corner % 2;
+            int cy = y + corner / 2;
+            // Only set kernel values inside the valid bounds of the kernel
+            if (cx >= 0 && cx < size && cy >= 0 && cy < size) {
+                kernel.at<float>(cy, cx) += weights[corner];
+                sum += weights[corner];  // Track the sum of all kernel values
+            }
         }
     }
 
@@ -52,67 +212,82 @@ cv::Mat BlurNode::generateDirectionalKernel(int radius, float angleDegrees) {
     return kernel;
 }
 
-// Generate a Gaussian kernel based on the given radius
+// Generate a Gaussian kernel based on the given radius, as the outer product of the 1D kernel
 cv::Mat BlurNode::generateGaussianKernel(int radius) {
-    int size = 2 * radius + 1;  // Kernel size based on the radius
-    cv::Mat kernel(size, size, CV_32F);  // Create an empty kernel matrix
+    cv::Mat row = gaussianKernel1D(radius, radius / 3.0f);
+    cv::Mat kernel = row * row.t();  // exp(-(x^2 + y^2)) = exp(-x^2) * exp(-y^2), and both factors sum to 1
+    return kernel;
+}
 
-    // Sigma value for Gaussian kernel, often set as radius/3 for reasonable blur
-    float sigma = radius / 3.0f;
-    float sum = 0.0f;
-    // Calculate Gaussian values for each pixel in the kernel
-    for (int y = -radius; y <= radius; y++) {
+// Look up, or build and remember, the normalized (2 * radius + 1) x 1 Gaussian kernel for `sigma`
+cv::Mat BlurNode::gaussianKernel1D(int radius, float sigma) {
+    std::lock_guard<std::mutex> lock(kernelCacheMutex);
+    cv::Mat& kernel = kernelCache[std::make_pair(radius, sigma)];
+    if (kernel.empty()) {
+        cv::Mat values(2 * radius + 1, 1, CV_32F);
+        float sum = 0.0f;
+        // Calculate Gaussian values for each tap of the kernel
         for (int x = -radius; x <= radius; x++) {
-            kernel.at<float>(y + radius, x + radius) = std::exp(-(x * x + y * y) / (2 * sigma * sigma));  // Gaussian formula
-            sum += kernel.at<float>(y + radius, x + radius);  // Sum of all kernel values
+            values.at<float>(x + radius) = std::exp(-(x * x) / (2 * sigma * sigma));  // Gaussian formula
+            sum += values.at<float>(x + radius);  // Sum of all kernel values
         }
+        values /= sum;  // Normalize the kernel to ensure the sum equals 1
+        kernel = values;
     }
-
-    kernel /= sum;  // Normalize the kernel to ensure the sum equals 1
-    return kernel;
+    return kernel;  // Shares the cached data, which is never written again
 }
 
 // Apply the blur effect to the input image using the selected kernel
 void BlurNode::process() {
     // Check if the input image is valid
     if (inputImage.empty()) {
-        std::cerr << "No input image for BlurNode: " << name << std::endl;
+        LOG_WARN("Blur", "no input node=" << name);
         return;
     }
 
-    // Select the appropriate kernel depending on whether directional blur is enabled
-    cv::Mat kernel;
+    useOutputAllocator(outputImage);  // Let the graph's buffer pool provide the result
+
+    // In preview mode the image is downscaled, so the radius shrinks with it
+    int effectiveRadius = scaledPixels(radius);
+
     if (directional) {
-        kernel = generateDirectionalKernel(radius, angle);  // Generate a directional kernel
-        std::cout << "Generated Directional Kernel." << std::endl;
+        // Average of bilinear samples along the angle, O(radius) per pixel
+        lineBlur(inputImage.read(), outputImage, effectiveRadius, angle);
+    } else if (approximate) {
+        // Stacked running-sum boxes: the same cost per pixel for a radius of 5 or 500
+        stackedBoxBlur(inputImage.read(), outputImage, effectiveRadius / 3.0f);
     } else {
-        kernel = generateGaussianKernel(radius);  // Generate a Gaussian kernel
-        std::cout << "Generated Gaussian Kernel." << std::endl;
+        // The Gaussian separates into a row pass and a column pass: O(radius) per pixel instead of O(radius^2)
+        cv::Mat kernel = gaussianKernel1D(effectiveRadius, effectiveRadius / 3.0f);  // Cached after the first use
+        cv::sepFilter2D(inputImage.read(), outputImage, -1, kernel, kernel);
     }
 
-    // Apply the kernel to the input image using convolution
-    cv::filter2D(inputImage, outputImage, -1, kernel);
-
     // Check if the output image is valid after the blur operation
     if (outputImage.empty()) {
-        std::cerr << "Failed to apply blur to the image." << std::endl;
+        LOG_ERROR("Blur", "failed node=" << name);
     } else {
-        std::cout << "Blur applied with radius: " << radius << " and " << (directional ? "directional" : "uniform") << " blur." << std::endl;
+        LOG_DEBUG("Blur", "applied node=" << name << " radius=" << effectiveRadius
+                               << " mode=" << (directional ? "directional" : approximate ? "box" : "gaussian"));
     }
 }
 
 // Render the user interface for controlling blur properties like radius and blur type
 void BlurNode::renderUI() {
-    std::cout << "[BlurNode: " << name << "]" << std::endl;
+    LOG_TRACE("Blur", "renderUI node=" << name);
+
+    // ImGui slider for controlling the blur radius; the box approximation makes very large radii affordable
+    if (ImGui::SliderInt("Radius", &radius, 1, approximate ? 400 : 20)) {
+        markDirty();  // Recalculate blur on the next run whenever the radius is changed
+    }
 
-    // ImGui slider for controlling the blur radius
-    if (ImGui::SliderInt("Radius", &radius, 1, 20)) {
-        process();  // Recalculate blur whenever the radius is changed
+    // ImGui checkbox to switch the Gaussian to its constant-time box approximation
+    if (ImGui::Checkbox("Fast Large-Radius Blur", &approximate)) {
+        markDirty();  // Recalculate blur on the next run whenever the approximation is toggled
     }
 
     // ImGui checkbox to toggle directional blur on or off
     if (ImGui::Checkbox("Directional Blur", &directional)) {
-        process();  // Recalculate blur whenever the directional blur option is toggled
+        markDirty();  // Recalculate blur on the next run whenever the directional option is toggled
     }
 
     // Generate and display a preview of the selected kernel (Gaussian or Directional)
@@ -124,29 +299,87 @@ void BlurNode::renderUI() {
     // Display the kernel preview in a separate window
     if (!kernelPreview.empty()) {
         cv::imshow("Kernel Preview", kernelPreview);
-        cv::waitKey(0);  // Wait for a key press before closing the preview window
+        cv::waitKey(1);  // Let the window repaint without blocking the UI thread
     }
 }
 
+// Context the blur reads around each output pixel: the radius, plus the bilinear neighbour for
+// directional blur, or the summed box radii when approximating
+int BlurNode::getHalo() const {
+    int effectiveRadius = scaledPixels(radius);
+    if (approximate && !directional) {
+        int halo = 0;
+        for (int boxRadius : stackedBoxRadii(effectiveRadius / 3.0f)) {
+            halo += boxRadius;
+        }
+        return std::max(halo, effectiveRadius);
+    }
+    if (directional) {
+        return effectiveRadius + 1;  // The outermost taps also read their bilinear neighbours
+    }
+    return effectiveRadius;
+}
+
 // Get the output image after the blur operation
 cv::Mat BlurNode::getOutput() const {
     return outputImage;
 }
 
-// Set a new radius and trigger reprocessing of the blur effect
+// Parameters that determine the blurred output
+ParamMap BlurNode::getParams() const {
+    return {{"radius", toParam(radius)},
+            {"directional", toParam(directional)},
+            {"angle", toParam(angle)},
+            {"approximate", toParam(approximate)}};
+}
+
+// Graph files refer to this node as "Blur"
+std::string BlurNode::getType() const {
+    return "Blur";
+}
+
+std::shared_ptr<Node> BlurNode::clone() const {
+    return std::make_shared<BlurNode>(*this);
+}
+
+// Restore radius, blur type and angle saved by getParams()
+void BlurNode::applyParams(const ParamMap& params) {
+    readParam(params, "radius", radius);
+    readParam(params, "directional", directional);
+    readParam(params, "angle", angle);
+    readParam(params, "approximate", approximate);
+    markDirty();
+}
+
+void BlurNode::releaseOutputs() {
+    outputImage.release();
+}
+
+// Release the input so its buffer returns to the pool
+void BlurNode::releaseInputs() {
+    inputImage.release();
+}
+
+// Set a new radius and mark the blur stale
 void BlurNode::setRadius(int newRadius) {
     radius = newRadius;
-    process();  // Recalculate blur with the new radius
+    markDirty();  // Recalculate blur with the new radius on the next run
 }
 
-// Set a new angle for directional blur and trigger reprocessing
+// Set a new angle for directional blur and mark the blur stale
 void BlurNode::setAngle(float newAngle) {
     angle = newAngle;
-    process();  // Recalculate blur with the new angle
+    markDirty();  // Recalculate blur with the new angle on the next run
+}
+
+// Enable or disable the box approximation of the Gaussian and mark the blur stale
+void BlurNode::setApproximate(bool enabled) {
+    approximate = enabled;
+    markDirty();  // Recalculate blur with the new method on the next run
 }
 
-// Enable or disable directional blur and trigger reprocessing
+// Enable or disable directional blur and mark the blur stale
 void BlurNode::setDirectional(bool isDirectional) {
     directional = isDirectional;
-    process();  // Recalculate blur with the new directional setting
+    markDirty();  // Recalculate blur with the new directional setting on the next run
 }
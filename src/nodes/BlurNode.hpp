@@ -1,23 +1,27 @@
 #pragma once
 #include "../graph/Node.hpp"  // Include the base Node class for inheritance
+#include "../graph/ImageHandle.hpp"
 #include <opencv2/opencv.hpp>  // OpenCV for image processing
-#include <iostream>  // For input-output operations
 
 // BlurNode class that inherits from the Node class
 class BlurNode : public Node {
 private:
-    cv::Mat inputImage;  // Input image to be processed
+    ImageHandle inputImage;  // Input image to be processed
     cv::Mat outputImage;  // Output image after processing (blurred)
     int radius = 3;  // Radius for the blur effect, default is 3
     bool directional = false;  // Flag to determine if directional blur is used
     float angle = 0.0f;  // Angle for directional blur, default is 0 (horizontal)
+    bool approximate = false;  // Approximate the Gaussian with stacked box filters, constant cost per pixel
 
-    // Function to generate a directional kernel based on radius and angle
+    // Function to generate a directional kernel based on radius and angle (used for the kernel preview)
     cv::Mat generateDirectionalKernel(int radius, float angle);
 
     // Function to generate a Gaussian blur kernel based on the radius
     cv::Mat generateGaussianKernel(int radius);
 
+    // Normalized 1D Gaussian kernel (a column), cached process-wide by radius and sigma
+    static cv::Mat gaussianKernel1D(int radius, float sigma);
+
 public:
     // Constructor to initialize the BlurNode with a name
     BlurNode(const std::string& name);
@@ -34,12 +38,32 @@ public:
     // Override method to get the processed (blurred) output image
     cv::Mat getOutput() const override;
 
-    // Method to set a new radius for the blur effect and apply the change
+    // The blur is local, so it can run per tile given `radius` pixels of context
+    bool isTileable() const override { return true; }
+    int getHalo() const override;
+
+    // Report radius, angle and blur type so the graph can cache the blurred output
+    ParamMap getParams() const override;
+
+    // "Blur" in graph files; applyParams() restores what getParams() reports
+    std::string getType() const override;
+    void applyParams(const ParamMap& params) override;
+
+    std::shared_ptr<Node> clone() const override;
+    void releaseOutputs() override;
+
+    // Forget the input so its buffer can be recycled once the graph is done with it
+    void releaseInputs() override;
+
+    // Method to set a new radius for the blur effect and mark the node dirty
     void setRadius(int newRadius);
 
-    // Method to set a new angle for directional blur and apply the change
+    // Method to set a new angle for directional blur and mark the node dirty
     void setAngle(float newAngle);
 
-    // Method to enable or disable directional blur and apply the change
+    // Method to switch the Gaussian to its stacked-box approximation (for radii in the hundreds) and mark the node dirty
+    void setApproximate(bool enabled);
+
+    // Method to enable or disable directional blur and mark the node dirty
     void setDirectional(bool isDirectional);
 };
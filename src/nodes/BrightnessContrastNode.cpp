@@ -1,5 +1,5 @@
 #include "BrightnessContrastNode.hpp"
-#include <iostream>
+#include "../graph/Log.hpp"
 
 // Constructor initializing the name and unique id for the node
 BrightnessContrastNode::BrightnessContrastNode(const std::string& name) {
@@ -18,39 +18,43 @@ BrightnessContrastNode::BrightnessContrastNode(const std::string& name, double a
 // Method to set the input image for processing
 void BrightnessContrastNode::setInput(const cv::Mat& input) {
     inputImage = input;
+    markDirty();
 }
 
 // Method to set new contrast (alpha) and brightness (beta) values
 void BrightnessContrastNode::setParams(double contrast, int brightness) {
     this->alpha = contrast;  // Set new contrast value
     this->beta = brightness; // Set new brightness value
+    markDirty();             // Recompute with the new values on the next graph run
 }
 
 // Method to reset the parameters to default values: α = 1.0 (no contrast change), β = 0 (no brightness change)
 void BrightnessContrastNode::resetParams() {
     this->alpha = 1.0;  // Default contrast is 1 (no change)
     this->beta = 0;     // Default brightness is 0 (no change)
-    std::cout << "Reset parameters to default: α = " << alpha << ", β = " << beta << std::endl;
+    markDirty();
+    LOG_DEBUG("BrightnessContrast", "reset node=" << name << " alpha=" << alpha << " beta=" << beta);
 }
 
 // Method to process the input image by applying brightness and contrast adjustments
 void BrightnessContrastNode::process() {
     // Check if the input image is empty
     if (inputImage.empty()) {
-        std::cerr << "No input image for BrightnessContrastNode: " << name << std::endl;
+        LOG_WARN("BrightnessContrast", "no input node=" << name);
         return;
     }
+
+    useOutputAllocator(outputImage);  // Let the graph's buffer pool provide the result
     
     // Apply contrast and brightness using OpenCV's convertTo method
-    inputImage.convertTo(outputImage, -1, alpha, beta);
-    std::cout << "Applied Brightness/Contrast to: " << name << std::endl;
+    inputImage.read().convertTo(outputImage, -1, alpha, beta);
+    LOG_DEBUG("BrightnessContrast", "applied node=" << name << " alpha=" << alpha << " beta=" << beta);
 }
 
 // Method to render the user interface for adjusting contrast (alpha) and brightness (beta) values
 void BrightnessContrastNode::renderUI() {
     // Log the current contrast and brightness values to the console
-    std::cout << "[BrightnessContrastNode: " << name 
-              << "] α = " << alpha << ", β = " << beta << std::endl;
+    LOG_TRACE("BrightnessContrast", "renderUI node=" << name << " alpha=" << alpha << " beta=" << beta);
 
     // Convert alpha to a float for the slider widget
     float alphaFloat = static_cast<float>(alpha);
@@ -58,11 +62,12 @@ void BrightnessContrastNode::renderUI() {
     // Render a slider for adjusting the contrast (α)
     if (ImGui::SliderFloat("Contrast (α)", &alphaFloat, 0.0f, 3.0f)) {
         alpha = static_cast<double>(alphaFloat);  // Update alpha with the new value from the slider
+        markDirty();
     }
 
     // Render a slider for adjusting the brightness (β)
     if (ImGui::SliderInt("Brightness (β)", &beta, -100, 100)) {
-        // Nothing needed here since the slider directly updates the beta value
+        markDirty();  // The slider directly updates beta, only the output needs refreshing
     }
 
     // Render a button to reset the contrast and brightness parameters to their defaults
@@ -72,6 +77,49 @@ void BrightnessContrastNode::renderUI() {
     }
 }
 
+// Method to describe the adjustment as a lookup table, built with the same convertTo call process() uses
+bool BrightnessContrastNode::getPointwiseOp(PointwiseOp& op) const {
+    cv::Mat ramp(1, 256, CV_8U), mapped;
+    for (int v = 0; v < 256; ++v) {
+        ramp.at<uchar>(0, v) = static_cast<uchar>(v);  // Every possible 8-bit input value
+    }
+    ramp.convertTo(mapped, -1, alpha, beta);
+
+    op.kind = PointwiseOp::Kind::Map;
+    op.table.assign(mapped.ptr<uchar>(0), mapped.ptr<uchar>(0) + 256);
+    return true;
+}
+
+// Method to report the parameters that determine the output
+ParamMap BrightnessContrastNode::getParams() const {
+    return {{"alpha", toParam(alpha)}, {"beta", toParam(beta)}};
+}
+
+// Method to name the node type in graph files
+std::string BrightnessContrastNode::getType() const {
+    return "BrightnessContrast";
+}
+
+std::shared_ptr<Node> BrightnessContrastNode::clone() const {
+    return std::make_shared<BrightnessContrastNode>(*this);
+}
+
+// Method to restore contrast (alpha) and brightness (beta) saved by getParams()
+void BrightnessContrastNode::applyParams(const ParamMap& params) {
+    readParam(params, "alpha", alpha);
+    readParam(params, "beta", beta);
+    markDirty();
+}
+
+void BrightnessContrastNode::releaseOutputs() {
+    outputImage.release();
+}
+
+// Method to release the input so its buffer returns to the pool
+void BrightnessContrastNode::releaseInputs() {
+    inputImage.release();
+}
+
 // Method to get the processed (output) image after applying brightness and contrast
 cv::Mat BrightnessContrastNode::getOutput() const {
     return outputImage;  // Return the output image
@@ -1,12 +1,13 @@
 #pragma once
 #include "../graph/Node.hpp"  // Base class Node is included to inherit from it
+#include "../graph/ImageHandle.hpp"
 #include <opencv2/opencv.hpp>  // OpenCV library for image processing
 #include <imgui.h>  // ImGui for rendering user interface
 
 // BrightnessContrastNode class: Inherits from Node, handles image brightness and contrast adjustments
 class BrightnessContrastNode : public Node {
 private:
-    cv::Mat inputImage;   // Stores the input image
+    ImageHandle inputImage;   // Stores the input image
     cv::Mat outputImage;  // Stores the output image after processing
     double alpha = 1.0;   // Contrast factor (default: no contrast change)
     int beta = 0;         // Brightness offset (default: no brightness change)
@@ -33,6 +34,25 @@ public:
     // Get the output image after applying brightness and contrast adjustments
     cv::Mat getOutput() const override;
 
+    // Per-pixel operation: any tile can be processed on its own, without extra context
+    bool isTileable() const override { return true; }
+
+    // On 8-bit images the adjustment is a 256-entry table, so it can be fused with its neighbours
+    bool getPointwiseOp(PointwiseOp& op) const override;
+
+    // Report contrast and brightness so the graph can cache the adjusted output
+    ParamMap getParams() const override;
+
+    // "BrightnessContrast" in graph files; applyParams() restores what getParams() reports
+    std::string getType() const override;
+    void applyParams(const ParamMap& params) override;
+
+    std::shared_ptr<Node> clone() const override;
+    void releaseOutputs() override;
+
+    // Forget the input so its buffer can be recycled once the graph is done with it
+    void releaseInputs() override;
+
     // Reset the contrast and brightness parameters to their default values
     void resetParams();
 };
@@ -1,6 +1,6 @@
 #include "ColorChannelSplitterNode.hpp"
+#include "../graph/Log.hpp"
 #include <opencv2/opencv.hpp>
-#include <iostream>
 #include <imgui.h>
 
 // Constructor: Initializes the node with a name and an option to output grayscale image
@@ -13,39 +13,54 @@ ColorChannelSplitterNode::ColorChannelSplitterNode(const std::string& name, bool
 // Sets the input image for processing
 void ColorChannelSplitterNode::setInput(const cv::Mat& input) {
     inputImage = input;
+    markDirty();
 }
 
 // Process the image by splitting it into color channels (Red, Green, Blue, and optionally Alpha)
 // If grayscale output is enabled, the grayscale image will also be generated
 void ColorChannelSplitterNode::process() {
+    // Start from empty ports, so a 3-channel image after a 4-channel one leaves no stale alpha
+    redChannel.release();
+    greenChannel.release();
+    blueChannel.release();
+    alphaChannel.release();
+
     if (inputImage.empty()) {
-        std::cerr << "No input image for ColorChannelSplitterNode: " << name << std::endl;
+        LOG_WARN("ColorChannelSplitter", "no input node=" << name);
         return;
     }
 
     cv::Mat grayscale;
     if (outputGrayscale) {
         // Convert to grayscale if enabled
-        cv::cvtColor(inputImage, grayscale, cv::COLOR_BGR2GRAY);
-        cv::imwrite("GrayScale.png", grayscale);  // Save the grayscale image
-        std::cout << "Image converted to grayscale." << std::endl;
+        cv::cvtColor(inputImage.read(), grayscale, cv::COLOR_BGR2GRAY);
+        if (interactive) {
+            cv::imwrite("GrayScale.png", grayscale);  // Save the grayscale image
+        }
+        LOG_DEBUG("ColorChannelSplitter", "converted to grayscale node=" << name);
     }
 
     std::vector<cv::Mat> channels;
     // Split the input image into its RGB (or RGBA) channels
-    if (inputImage.channels() == 3) {
-        cv::split(inputImage, channels);
+    if (inputImage.read().channels() == 3) {
+        cv::split(inputImage.read(), channels);
         redChannel = channels[2];
         greenChannel = channels[1];
         blueChannel = channels[0];
-    } else if (inputImage.channels() == 4) {
-        cv::split(inputImage, channels);
+    } else if (inputImage.read().channels() == 4) {
+        cv::split(inputImage.read(), channels);
         redChannel = channels[2];
         greenChannel = channels[1];
         blueChannel = channels[0];
         alphaChannel = channels[3];
     }
 
+    // Headless runs stop here: the debug images and preview windows below would block or
+    // overwrite each other when many images are processed
+    if (!interactive) {
+        return;
+    }
+
     // Save each channel as separate images
     if (!redChannel.empty()) {
         cv::imwrite("Red_Channel.png", redChannel);
@@ -84,7 +99,7 @@ void ColorChannelSplitterNode::process() {
 // Merge the individual RGB (or RGBA) channels back into a single image
 cv::Mat ColorChannelSplitterNode::mergeChannels() {
     if (redChannel.empty() || greenChannel.empty() || blueChannel.empty()) {
-        std::cerr << "One or more channels are empty, cannot merge." << std::endl;
+        LOG_ERROR("ColorChannelSplitter", "cannot merge, a channel is empty");
         return cv::Mat();  // Return an empty matrix if any channel is empty
     }
 
@@ -97,11 +112,11 @@ cv::Mat ColorChannelSplitterNode::mergeChannels() {
 
 // Render the user interface for the ColorChannelSplitterNode to adjust settings and visualize channels
 void ColorChannelSplitterNode::renderUI() {
-    std::cout << "[ColorChannelSplitterNode: " << name << "]" << std::endl;
+    LOG_TRACE("ColorChannelSplitter", "renderUI node=" << name);
 
     // Checkbox to toggle grayscale output
     if (ImGui::Checkbox("Output Grayscale", &outputGrayscale)) {
-        process();
+        markDirty();
     }
 
     // Display the Red, Green, Blue, and Alpha channels if available
@@ -143,18 +158,73 @@ cv::Mat ColorChannelSplitterNode::getOutput() const {
     if (outputGrayscale) {
         return redChannel;  // If grayscale, return the red channel (or any single channel)
     } else {
-        return inputImage;  // Otherwise, return the original input image
+        return inputImage.read();  // Otherwise, return the original input image
     }
 }
 
-// Enable or disable grayscale output, and reprocess the image accordingly
+// Every split channel is published on its own port, next to the regular output
+std::vector<Node::Port> ColorChannelSplitterNode::getOutputPorts() const {
+    return {{"output", PortType::Image},
+            {"red", PortType::Mask},
+            {"green", PortType::Mask},
+            {"blue", PortType::Mask},
+            {"alpha", PortType::Mask}};
+}
+
+// Channel ports hand out the split planes directly; they share memory with nothing upstream
+cv::Mat ColorChannelSplitterNode::getOutputPort(const std::string& port) const {
+    if (port == "red") {
+        return redChannel;
+    } else if (port == "green") {
+        return greenChannel;
+    } else if (port == "blue") {
+        return blueChannel;
+    } else if (port == "alpha") {
+        return alphaChannel;
+    }
+    return getOutput();
+}
+
+// The grayscale flag is the only parameter that changes the outputs
+ParamMap ColorChannelSplitterNode::getParams() const {
+    return {{"outputGrayscale", toParam(outputGrayscale)}};
+}
+
+// Graph files refer to this node as "ColorChannelSplitter"
+std::string ColorChannelSplitterNode::getType() const {
+    return "ColorChannelSplitter";
+}
+
+std::shared_ptr<Node> ColorChannelSplitterNode::clone() const {
+    return std::make_shared<ColorChannelSplitterNode>(*this);
+}
+
+// Restore the grayscale flag saved by getParams()
+void ColorChannelSplitterNode::applyParams(const ParamMap& params) {
+    readParam(params, "outputGrayscale", outputGrayscale);
+    markDirty();
+}
+
+void ColorChannelSplitterNode::releaseOutputs() {
+    redChannel.release();
+    greenChannel.release();
+    blueChannel.release();
+    alphaChannel.release();
+}
+
+// Release the input so its buffer returns to the pool
+void ColorChannelSplitterNode::releaseInputs() {
+    inputImage.release();
+}
+
+// Enable or disable grayscale output, and mark the node stale so it is reprocessed
 void ColorChannelSplitterNode::setOutputGrayscale(bool enable) {
     outputGrayscale = enable;
-    process();
+    markDirty();
 }
 
-// Reset parameters, disabling grayscale output and reprocessing the image
+// Reset parameters, disabling grayscale output and marking the node stale
 void ColorChannelSplitterNode::resetParams() {
     outputGrayscale = false;
-    process();
+    markDirty();
 }
@@ -1,5 +1,6 @@
 #pragma once
 #include "../graph/Node.hpp"
+#include "../graph/ImageHandle.hpp"
 #include <opencv2/opencv.hpp>
 #include <vector>
 
@@ -21,6 +22,25 @@ public:
     // Returns the processed image based on grayscale flag (either the input image or the red channel)
     cv::Mat getOutput() const override;
 
+    // Exposes "output" plus one mask port per channel ("red", "green", "blue", "alpha")
+    std::vector<Port> getOutputPorts() const override;
+
+    // Returns the channel (or the regular output) published on the given port
+    cv::Mat getOutputPort(const std::string& port) const override;
+
+    // Reports the grayscale flag so the graph can cache the split channels
+    ParamMap getParams() const override;
+
+    // "ColorChannelSplitter" in graph files; applyParams() restores what getParams() reports
+    std::string getType() const override;
+    void applyParams(const ParamMap& params) override;
+
+    std::shared_ptr<Node> clone() const override;
+    void releaseOutputs() override;
+
+    // Forgets the input so its buffer can be recycled once the graph is done with it
+    void releaseInputs() override;
+
     // Merges the individual RGB (or RGBA) channels back into a single image
     cv::Mat mergeChannels();
 
@@ -31,7 +51,7 @@ public:
     void resetParams();
 
     // Member variables to hold the input image and the individual color channels (Red, Green, Blue, Alpha)
-    cv::Mat inputImage; 
+    ImageHandle inputImage; 
     cv::Mat redChannel;
     cv::Mat greenChannel;
     cv::Mat blueChannel;
@@ -1,5 +1,106 @@
 #include "ConvolutionFilterNode.hpp"
-#include <iostream>
+#include "../graph/Log.hpp"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace
+{
+
+// How convolveFFT() cuts an image into tiles for a kernel of size k: transforms of at least
+// 256, or 4 kernels wide, keep the discarded overlap a small fraction
+struct FFTTiling
+{
+    int dftWidth, dftHeight;   // Transform size
+    int tileWidth, tileHeight; // Output pixels each transform produces
+    int tilesAcross, tilesDown;
+};
+
+FFTTiling fftTiling(const cv::Size &image, int k)
+{
+    const int desired = std::max(256, 4 * k);
+    FFTTiling tiling;
+    tiling.dftWidth = cv::getOptimalDFTSize(std::min(image.width, desired - k + 1) + k - 1);
+    tiling.dftHeight = cv::getOptimalDFTSize(std::min(image.height, desired - k + 1) + k - 1);
+    tiling.tileWidth = tiling.dftWidth - k + 1;
+    tiling.tileHeight = tiling.dftHeight - k + 1;
+    tiling.tilesAcross = (image.width + tiling.tileWidth - 1) / tiling.tileWidth;
+    tiling.tilesDown = (image.height + tiling.tileHeight - 1) / tiling.tileHeight;
+    return tiling;
+}
+
+// Correlates `input` with `kernel` exactly like filter2D (anchor at the centre, mirrored
+// border), through the frequency domain. The padded image is cut into tiles whose transforms
+// are a little larger than the tile plus the kernel; each tile is transformed, multiplied by the
+// kernel's spectrum and transformed back, and only the part that did not wrap around is kept
+// (overlap-save). Cost per pixel grows with log(tile size) rather than with the kernel area, and
+// tiles run in parallel. `kernelSpectrum` is reused when it already has the transform size,
+// otherwise it is replaced by a new one.
+void convolveFFT(const cv::Mat &input, cv::Mat &output, const cv::Mat &kernel, cv::Mat &kernelSpectrum)
+{
+    const int k = kernel.rows;
+    const int r = k / 2;
+    const int channels = input.channels();
+
+    const FFTTiling tiling = fftTiling(input.size(), k);
+    const int dftWidth = tiling.dftWidth;
+    const int dftHeight = tiling.dftHeight;
+    const int tileWidth = tiling.tileWidth;
+    const int tileHeight = tiling.tileHeight;
+
+    // Kernel spectrum, shared by every tile and channel (and by later runs on images that tile alike)
+    if (kernelSpectrum.size() != cv::Size(dftWidth, dftHeight))
+    {
+        cv::Mat spectrum = cv::Mat::zeros(dftHeight, dftWidth, CV_32F); // Fresh buffer: clones may share the old one
+        kernel.copyTo(spectrum(cv::Rect(0, 0, k, k)));
+        cv::dft(spectrum, spectrum, 0, k);
+        kernelSpectrum = spectrum;
+    }
+
+    cv::Mat image, padded;
+    input.convertTo(image, CV_MAKETYPE(CV_32F, channels));
+    cv::copyMakeBorder(image, padded, r, r, r, r, cv::BORDER_REFLECT_101);
+    std::vector<cv::Mat> planes;
+    cv::split(padded, planes);
+
+    std::vector<cv::Mat> results(channels);
+    for (auto &result : results)
+    {
+        result.create(input.size(), CV_32F);
+    }
+
+    const int tilesAcross = tiling.tilesAcross;
+    const int tilesDown = tiling.tilesDown;
+    cv::parallel_for_(cv::Range(0, tilesAcross * tilesDown * channels), [&](const cv::Range &range)
+    {
+        cv::Mat block(dftHeight, dftWidth, CV_32F);
+        cv::Mat spectrum, filtered;
+        for (int task = range.start; task < range.end; ++task)
+        {
+            const int channel = task % channels;
+            const int tile = task / channels;
+            const cv::Rect out((tile % tilesAcross) * tileWidth, (tile / tilesAcross) * tileHeight, 0, 0);
+            const int width = std::min(tileWidth, input.cols - out.x);
+            const int height = std::min(tileHeight, input.rows - out.y);
+
+            // The tile's output needs the padded pixels from its corner to kernel size - 1 beyond it
+            block.setTo(0);
+            planes[channel](cv::Rect(out.x, out.y, width + k - 1, height + k - 1))
+                .copyTo(block(cv::Rect(0, 0, width + k - 1, height + k - 1)));
+
+            cv::dft(block, spectrum, 0, height + k - 1);
+            cv::mulSpectrums(spectrum, kernelSpectrum, spectrum, 0, true);  // Conjugate: correlation, like filter2D
+            cv::idft(spectrum, filtered, cv::DFT_SCALE | cv::DFT_REAL_OUTPUT, height);
+            filtered(cv::Rect(0, 0, width, height)).copyTo(results[channel](cv::Rect(out.x, out.y, width, height)));
+        }
+    });
+
+    cv::Mat merged;
+    cv::merge(results, merged);
+    merged.convertTo(output, input.depth());  // Rounds and saturates like filter2D
+}
+
+}
 
 // Constructor: Initializes the node with an id and name, and sets the node type to Processing
 ConvolutionFilterNode::ConvolutionFilterNode(const std::string &id, const std::string &name)
@@ -9,13 +110,15 @@ ConvolutionFilterNode::ConvolutionFilterNode(const std::string &id, const std::s
     this->nodeType = NodeType::Processing;
 }
 
-// Sets the kernel size for the convolution filter (either 3x3 or 5x5)
+// Sets the kernel size for the convolution filter (any odd size, so the kernel has a centre)
 void ConvolutionFilterNode::setKernelSize(int size)
 {
-    if (size == 3 || size == 5)
+    if (size >= 1 && size <= maxKernelSize && size % 2 == 1)
     {
         kernelSize = size;
-        kernelData.resize(size * size, 0.0f); // Initialize kernel data with zeroes
+        kernelData.assign(size * size, 0.0f); // Start from an all-zero kernel; the old weights don't fit the new shape
+        preset = PresetType::Custom;          // No preset has this kernel any more
+        markDirty();
     }
 }
 
@@ -26,20 +129,30 @@ void ConvolutionFilterNode::setCustomKernel(const std::vector<float> &data)
     {
         kernelData = data; // Store the custom kernel data
         preset = PresetType::Custom; // Mark this as a custom preset
+        markDirty();
     }
 }
 
+// Forces direct, separable or FFT convolution, or returns to the automatic choice
+void ConvolutionFilterNode::setMethod(Method newMethod)
+{
+    method = newMethod;
+    markDirty(); // Methods agree up to rounding, but the cached output is keyed on the method too
+}
+
 // Sets a predefined filter preset (Sharpen, Emboss, Edge Enhance)
 void ConvolutionFilterNode::setPreset(PresetType type)
 {
     preset = type;
     loadPreset(type); // Load the chosen preset kernel
+    markDirty();
 }
 
 // Sets the input image for processing
 void ConvolutionFilterNode::setInput(const cv::Mat &input)
 {
-    inputImage = input.clone(); // Clone the input image to avoid modifying the original
+    inputImage = input; // filter2D never writes to its source, so sharing the buffer is safe
+    markDirty();
 }
 
 // Applies the selected kernel to the input image and produces the output
@@ -51,7 +164,7 @@ void ConvolutionFilterNode::process()
 // Renders the user interface (currently just a placeholder for rendering logic)
 void ConvolutionFilterNode::renderUI()
 {
-    std::cout << "Rendering UI for Convolution Filter Node\n";
+    LOG_TRACE("ConvolutionFilter", "renderUI node=" << name);
     // Add your ImGui UI rendering logic here
 }
 
@@ -61,17 +174,202 @@ cv::Mat ConvolutionFilterNode::getOutput() const
     return outputImage; // Return the processed image
 }
 
+// Reports the kernel size, every kernel weight and the preset
+ParamMap ConvolutionFilterNode::getParams() const
+{
+    std::string weights;
+    for (size_t i = 0; i < kernelData.size(); ++i)
+    {
+        weights += (i ? "," : "") + toParam(kernelData[i]);
+    }
+    return {{"kernelSize", toParam(kernelSize)},
+            {"kernel", weights},
+            {"preset", toParam(static_cast<int>(preset))},
+            {"method", toParam(static_cast<int>(method))}};
+}
+
+// Graph files refer to this node as "ConvolutionFilter"
+std::string ConvolutionFilterNode::getType() const
+{
+    return "ConvolutionFilter";
+}
+
+std::shared_ptr<Node> ConvolutionFilterNode::clone() const
+{
+    return std::make_shared<ConvolutionFilterNode>(*this);
+}
+
+// Restores the kernel saved by getParams(): a preset is reloaded, custom weights are parsed
+void ConvolutionFilterNode::applyParams(const ParamMap &params)
+{
+    int type = static_cast<int>(preset); // Read before setKernelSize() resets it to Custom
+    int size = kernelSize;
+    if (readParam(params, "kernelSize", size))
+    {
+        setKernelSize(size); // Ignores even and out-of-range sizes
+    }
+
+    int methodIndex = static_cast<int>(method);
+    if (readParam(params, "method", methodIndex) && methodIndex >= static_cast<int>(Method::Auto) &&
+        methodIndex <= static_cast<int>(Method::FFT))
+    {
+        method = static_cast<Method>(methodIndex);
+    }
+
+    readParam(params, "preset", type);
+    if (type > static_cast<int>(PresetType::Custom) && type <= static_cast<int>(PresetType::EdgeEnhance))
+    {
+        setPreset(static_cast<PresetType>(type));
+    }
+    else
+    {
+        std::string weights;
+        if (readParam(params, "kernel", weights))
+        {
+            std::vector<float> data;
+            std::stringstream in(weights);
+            std::string weight;
+            float value = 0.0f;
+            while (std::getline(in, weight, ',') && std::istringstream(weight) >> value)
+            {
+                data.push_back(value);
+            }
+            setCustomKernel(data); // Ignored unless it has kernelSize * kernelSize weights
+        }
+    }
+    markDirty();
+}
+
+void ConvolutionFilterNode::releaseOutputs()
+{
+    outputImage.release();
+}
+
+// Releases the input so its buffer returns to the pool
+void ConvolutionFilterNode::releaseInputs()
+{
+    inputImage.release();
+}
+
 // Applies the chosen kernel to the input image using OpenCV's filter2D function
 void ConvolutionFilterNode::applyKernel()
 {
     if (inputImage.empty())
         return; // Ensure the input image is not empty
+    if (kernelData.size() != static_cast<size_t>(kernelSize) * kernelSize)
+    {
+        LOG_WARN("ConvolutionFilter", "no kernel set node=" << name << " size=" << kernelSize);
+        return;
+    }
 
     // Create a CV_32F matrix for the kernel from the kernel data
     cv::Mat kernel(kernelSize, kernelSize, CV_32F, const_cast<float *>(kernelData.data()));
 
-    // Apply the kernel using filter2D to perform the convolution
-    cv::filter2D(inputImage, outputImage, -1, kernel);
+    // Analyse the kernel only when its weights changed since the last run
+    if (decomposedKernel != kernelData)
+    {
+        decomposeKernel();
+    }
+
+    useOutputAllocator(outputImage); // Let the graph's buffer pool provide the result
+    switch (chooseMethod(inputImage.read().size()))
+    {
+    case Method::Separable:
+        if (termColumns.size() == 1)
+        {
+            cv::sepFilter2D(inputImage.read(), outputImage, -1, termRows[0], termColumns[0]); // Two 1D passes, O(k) per pixel
+        }
+        else
+        {
+            // One pair of 1D passes per term, summed in float and rounded once at the end
+            cv::Mat sum, term;
+            for (size_t i = 0; i < termColumns.size(); ++i)
+            {
+                cv::sepFilter2D(inputImage.read(), term, CV_32F, termRows[i], termColumns[i]);
+                if (i == 0)
+                {
+                    sum = term;
+                    term = cv::Mat(); // The next term gets its own buffer
+                }
+                else
+                {
+                    sum += term;
+                }
+            }
+            sum.convertTo(outputImage, inputImage.read().depth());
+        }
+        break;
+    case Method::FFT:
+        convolveFFT(inputImage.read(), outputImage, kernel, kernelSpectrum); // Tiled frequency-domain correlation
+        break;
+    default:
+        cv::filter2D(inputImage.read(), outputImage, -1, kernel); // Direct, O(k^2) per pixel
+        break;
+    }
+}
+
+// Picks the cheapest method for the kernel and image, unless one was forced. Costs are
+// multiply-adds per pixel: k^2 direct, 2k per separable term, and for the FFT a fixed amount per
+// transformed sample, times the samples all tiles transform over the pixels they produce.
+ConvolutionFilterNode::Method ConvolutionFilterNode::chooseMethod(const cv::Size &size) const
+{
+    const size_t directCost = static_cast<size_t>(kernelSize) * kernelSize;
+    const size_t separableCost = 2 * static_cast<size_t>(kernelSize) * termColumns.size();
+
+    const FFTTiling tiling = fftTiling(size, kernelSize);
+    const double transformed = static_cast<double>(tiling.tilesAcross) * tiling.tilesDown * tiling.dftWidth * tiling.dftHeight;
+    const size_t fftCost = static_cast<size_t>(fftCostPerSample * transformed / std::max(1, size.area()));
+
+    switch (method)
+    {
+    case Method::Direct:
+    case Method::FFT:
+        return method;
+    case Method::Separable:
+        if (termColumns.empty())
+        {
+            LOG_WARN("ConvolutionFilter", "kernel is all zeros, using direct convolution node=" << name);
+            return Method::Direct;
+        }
+        return Method::Separable;
+    default:
+        break;
+    }
+
+    if (kernelSize <= 3)
+        return Method::Direct; // Nine taps: nothing beats the direct loop
+    if (!termColumns.empty() && separableCost < directCost && separableCost < fftCost)
+        return Method::Separable;
+    return directCost <= fftCost ? Method::Direct : Method::FFT;
+}
+
+// Factors the kernel with an SVD into a sum of column x row products, one per significant
+// singular value. A Gaussian or box is one term; a kernel of rank r needs r terms, and the
+// node uses them when 2k multiply-adds per term beat the alternatives.
+void ConvolutionFilterNode::decomposeKernel()
+{
+    termColumns.clear();
+    termRows.clear();
+    kernelSpectrum.release(); // Belongs to the old weights
+    decomposedKernel = kernelData;
+
+    cv::Mat kernel(kernelSize, kernelSize, CV_32F, kernelData.data());
+    cv::Mat precise, singular, left, rightT;
+    kernel.convertTo(precise, CV_64F); // Double precision, so float kernels reconstruct exactly
+    cv::SVD::compute(precise, singular, left, rightT);
+
+    // Terms below this share of the largest singular value are float rounding, not structure
+    const double largest = singular.empty() ? 0.0 : singular.at<double>(0);
+    for (int i = 0; i < singular.rows && singular.at<double>(i) > 1e-6 * largest; ++i)
+    {
+        const double scale = std::sqrt(singular.at<double>(i)); // Split evenly between both factors
+        cv::Mat column, row;
+        cv::Mat(left.col(i) * scale).convertTo(column, CV_32F);
+        cv::Mat(rightT.row(i) * scale).convertTo(row, CV_32F);
+        termColumns.push_back(column);
+        termRows.push_back(row);
+    }
+    LOG_DEBUG("ConvolutionFilter", "decomposed node=" << name << " size=" << kernelSize << " terms=" << termColumns.size());
 }
 
 // Loads the appropriate preset kernel based on the preset type
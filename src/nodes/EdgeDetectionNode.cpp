@@ -1,6 +1,6 @@
 #include "EdgeDetectionNode.hpp"
+#include "../graph/Log.hpp"
 #include <opencv2/opencv.hpp>
-#include <iostream>
 #include <imgui.h>
 
 // Constructor: sets the node's display name and generates a unique ID
@@ -14,6 +14,7 @@ EdgeDetectionNode::EdgeDetectionNode(const std::string &name)
 void EdgeDetectionNode::setInput(const cv::Mat &input)
 {
     inputImage = input;
+    markDirty();
 }
 
 // Main processing function to apply edge detection
@@ -21,22 +22,24 @@ void EdgeDetectionNode::process()
 {
     if (inputImage.empty())
     {
-        std::cerr << "No input image for EdgeDetectionNode: " << name << std::endl;
+        LOG_WARN("EdgeDetection", "no input node=" << name);
         return;
     }
 
-    // Keep a copy of the original for optional overlay
-    cv::Mat originalColor = inputImage.clone();
+    useOutputAllocator(outputImage); // Let the graph's buffer pool provide the result
+
+    // The original, for the optional overlay
+    const cv::Mat& originalColor = inputImage.read();  // Only read, so no copy is needed
 
     // Convert to grayscale if needed
     cv::Mat grayImage;
-    if (inputImage.channels() != 1)
+    if (inputImage.read().channels() != 1)
     {
-        cv::cvtColor(inputImage, grayImage, cv::COLOR_BGR2GRAY);
+        cv::cvtColor(inputImage.read(), grayImage, cv::COLOR_BGR2GRAY);
     }
     else
     {
-        grayImage = inputImage;
+        grayImage = inputImage.read();
     }
 
     // Apply edge detection based on selected method
@@ -64,25 +67,25 @@ void EdgeDetectionNode::process()
 
     if (outputImage.empty())
     {
-        std::cerr << "Failed to apply edge detection." << std::endl;
+        LOG_ERROR("EdgeDetection", "failed node=" << name);
     }
 }
 
 // Renders the ImGui UI for selecting edge detection type and parameters
 void EdgeDetectionNode::renderUI()
 {
-    std::cout << "[EdgeDetectionNode: " << name << "]" << std::endl;
+    LOG_TRACE("EdgeDetection", "renderUI node=" << name);
 
     // Select between Sobel and Canny
     if (ImGui::RadioButton("Sobel", edgeDetectionType == SOBEL))
     {
         edgeDetectionType = SOBEL;
-        process();
+        markDirty();
     }
     if (ImGui::RadioButton("Canny", edgeDetectionType == CANNY))
     {
         edgeDetectionType = CANNY;
-        process();
+        markDirty();
     }
 
     // Adjustable parameter: kernel size for Sobel
@@ -90,7 +93,7 @@ void EdgeDetectionNode::renderUI()
     {
         if (ImGui::SliderInt("Sobel Kernel Size", &sobelKernelSize, 1, 7))
         {
-            process();
+            markDirty();
         }
     }
 
@@ -99,18 +102,18 @@ void EdgeDetectionNode::renderUI()
     {
         if (ImGui::SliderInt("Canny Threshold 1", &cannyThreshold1, 0, 255))
         {
-            process();
+            markDirty();
         }
         if (ImGui::SliderInt("Canny Threshold 2", &cannyThreshold2, 0, 255))
         {
-            process();
+            markDirty();
         }
     }
 
     // Option to overlay edges on original image
     if (ImGui::Checkbox("Overlay Edges", &overlayEdges))
     {
-        process();
+        markDirty();
     }
 }
 
@@ -120,28 +123,75 @@ cv::Mat EdgeDetectionNode::getOutput() const
     return outputImage;
 }
 
-// Manual setters to change settings programmatically
+// Parameters that determine the edge map
+ParamMap EdgeDetectionNode::getParams() const
+{
+    return {{"type", toParam(static_cast<int>(edgeDetectionType))},
+            {"sobelKernelSize", toParam(sobelKernelSize)},
+            {"cannyThreshold1", toParam(cannyThreshold1)},
+            {"cannyThreshold2", toParam(cannyThreshold2)},
+            {"overlayEdges", toParam(overlayEdges)}};
+}
+
+// Graph files refer to this node as "EdgeDetection"
+std::string EdgeDetectionNode::getType() const
+{
+    return "EdgeDetection";
+}
+
+std::shared_ptr<Node> EdgeDetectionNode::clone() const
+{
+    return std::make_shared<EdgeDetectionNode>(*this);
+}
+
+// Restore the algorithm and its settings saved by getParams()
+void EdgeDetectionNode::applyParams(const ParamMap &params)
+{
+    int type = static_cast<int>(edgeDetectionType);
+    if (readParam(params, "type", type) && (type == SOBEL || type == CANNY))
+    {
+        edgeDetectionType = static_cast<EdgeDetectionType>(type);
+    }
+    readParam(params, "sobelKernelSize", sobelKernelSize);
+    readParam(params, "cannyThreshold1", cannyThreshold1);
+    readParam(params, "cannyThreshold2", cannyThreshold2);
+    readParam(params, "overlayEdges", overlayEdges);
+    markDirty();
+}
+
+void EdgeDetectionNode::releaseOutputs()
+{
+    outputImage.release();
+}
+
+// Release the input so its buffer returns to the pool
+void EdgeDetectionNode::releaseInputs()
+{
+    inputImage.release();
+}
+
+// Manual setters to change settings programmatically; the graph recomputes stale nodes on its next run
 void EdgeDetectionNode::setEdgeDetectionType(EdgeDetectionType type)
 {
     edgeDetectionType = type;
-    process();
+    markDirty();
 }
 
 void EdgeDetectionNode::setSobelKernelSize(int size)
 {
     sobelKernelSize = size;
-    process();
+    markDirty();
 }
 
 void EdgeDetectionNode::setCannyThresholds(int threshold1, int threshold2)
 {
     cannyThreshold1 = threshold1;
     cannyThreshold2 = threshold2;
-    process();
+    markDirty();
 }
 
 void EdgeDetectionNode::setOverlayEdges(bool overlay)
 {
     overlayEdges = overlay;
-    process();
+    markDirty();
 }
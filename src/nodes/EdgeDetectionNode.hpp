@@ -1,13 +1,13 @@
 #pragma once
 #include "../graph/Node.hpp"
+#include "../graph/ImageHandle.hpp"
 #include <opencv2/opencv.hpp>
-#include <iostream>
 
 // EdgeDetectionNode performs either Sobel or Canny edge detection
 class EdgeDetectionNode : public Node
 {
 private:
-    cv::Mat inputImage;     // Input image
+    ImageHandle inputImage;     // Input image
     cv::Mat outputImage;    // Processed output image
     bool overlayEdges = false; // If true, overlays edges on original image
 
@@ -40,6 +40,25 @@ public:
     // Retrieve processed image
     cv::Mat getOutput() const override;
 
+    // Sobel only needs its aperture as context; Canny's hysteresis follows edges across
+    // the whole frame, so it cannot be split into tiles. A kernel size of 1 still reads a
+    // 3x3 neighbourhood here, since the x and y derivatives are taken together
+    bool isTileable() const override { return edgeDetectionType == SOBEL; }
+    int getHalo() const override { return std::max(1, sobelKernelSize / 2); }
+
+    // Report the algorithm and its settings so the graph can cache the edge map
+    ParamMap getParams() const override;
+
+    // "EdgeDetection" in graph files; applyParams() restores what getParams() reports
+    std::string getType() const override;
+    void applyParams(const ParamMap& params) override;
+
+    std::shared_ptr<Node> clone() const override;
+    void releaseOutputs() override;
+
+    // Forget the input so its buffer can be recycled once the graph is done with it
+    void releaseInputs() override;
+
     // Manual configuration methods
     void setEdgeDetectionType(EdgeDetectionType type);
     void setSobelKernelSize(int size);
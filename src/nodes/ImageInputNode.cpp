@@ -1,20 +1,111 @@
 #include "ImageInputNode.hpp"
+#include "../graph/Log.hpp"
+#include "../graph/RawImage.hpp"
 #include <opencv2/opencv.hpp>
-#include <iostream>
+#include <filesystem>
 
 // Constructor initializes name and file path
 ImageInputNode::ImageInputNode(const std::string& name, const std::string& filePath)
-    : Node(), filePath(filePath), name(name) {}
+    : Node(), filePath(filePath) {
+    this->name = name;
+    this->id = "image_input_" + name;
+}
 
 // Load image from disk and prepare it for pipeline
 void ImageInputNode::process() {
-    input = cv::imread(filePath);  // Load image using OpenCV
+    if (!preloaded) {
+        // Decode again only if the file changed; switching preview scales reuses the image
+        long long stamp = fileStamp();
+        if (input.empty() || filePath != decodedPath || stamp != decodedStamp) {
+            input = readImage(filePath);  // Decode with OpenCV, or map a raw image without copying
+            decodedPath = filePath;
+            decodedStamp = stamp;
+        }
+    }
 
     if (input.empty()) {
-        std::cerr << "❌ Failed to load image: " << filePath << std::endl;
+        LOG_ERROR("ImageInput", "load failed node=" << name << " path=" << filePath);
+    } else if (resolutionScale < 1.0) {
+        output = makeProxy(resolutionScale);  // Preview: downstream nodes work on a small proxy
     } else {
-        output = input.clone();  // Copy input to output for downstream nodes
+        output = input.read();  // Share the decoded pixels; downstream nodes only read their inputs
+    }
+}
+
+// Walk down the pyramid to the smallest level still at least as large as the proxy
+cv::Mat ImageInputNode::makeProxy(double scale) {
+    if (pyramid.empty() || pyramid.front().data != input.read().data || pyramid.front().size() != input.read().size()) {
+        pyramid.assign(1, input.read());  // A different image: the old levels are useless
+    }
+
+    cv::Size target(std::max(1, static_cast<int>(std::lround(input.read().cols * scale))),
+                    std::max(1, static_cast<int>(std::lround(input.read().rows * scale))));
+    while (pyramid.back().cols / 2 >= target.width && pyramid.back().rows / 2 >= target.height) {
+        cv::Mat half;
+        cv::pyrDown(pyramid.back(), half);
+        pyramid.push_back(half);
+    }
+
+    size_t level = 0;
+    while (level + 1 < pyramid.size() && pyramid[level + 1].cols >= target.width && pyramid[level + 1].rows >= target.height) {
+        ++level;
+    }
+
+    cv::Mat proxy;
+    cv::resize(pyramid[level], proxy, target, 0, 0, cv::INTER_AREA);  // Always a new buffer
+    return proxy;
+}
+
+// Last write time of the source file, used to notice edits on disk
+long long ImageInputNode::fileStamp() const {
+    std::error_code error;
+    auto modified = std::filesystem::last_write_time(filePath, error);
+    return error ? 0 : static_cast<long long>(modified.time_since_epoch().count());
+}
+
+// Identify the image by path and last write time
+ParamMap ImageInputNode::getParams() const {
+    long long stamp = fileStamp();
+    if (preloaded) {
+        return {{"filePath", filePath}, {"image", toParam(imageSerial)}};  // Nothing on disk identifies a fed image
+    }
+    return {{"filePath", filePath}, {"modified", toParam(stamp)}};
+}
+
+// Graph files refer to this node as "ImageInput"
+std::string ImageInputNode::getType() const {
+    return "ImageInput";
+}
+
+std::shared_ptr<Node> ImageInputNode::clone() const {
+    return std::make_shared<ImageInputNode>(*this);
+}
+
+// Point the node at the saved file path; the modification time is re-read from disk
+void ImageInputNode::applyParams(const ParamMap& params) {
+    if (readParam(params, "filePath", filePath)) {
+        preloaded = false;
     }
+    markDirty();
+}
+
+void ImageInputNode::releaseOutputs() {
+    output.release();
+}
+
+// Release the decoded original so its buffer can be recycled
+void ImageInputNode::releaseInputs() {
+    input.release();
+    pyramid.clear();
+}
+
+// Use an already decoded image as the source until applyParams() points the node at a file again
+void ImageInputNode::setImage(const cv::Mat& image) {
+    input = image;
+    pyramid.clear();
+    preloaded = true;
+    ++imageSerial;
+    markDirty();
 }
 
 // Allow external override of output (optional feature)
@@ -29,15 +120,15 @@ cv::Mat ImageInputNode::getOutput() const {
 
 // Render ImGui UI (optional future use)
 void ImageInputNode::renderUI() {
-    std::cout << "🖼️ Rendering UI for Image Input Node: " << name << std::endl;
+    LOG_TRACE("ImageInput", "renderUI node=" << name);
 }
 
 // Convert loaded image to grayscale
 void ImageInputNode::convertToGrayscale() {
     if (!input.empty()) {
-        cv::cvtColor(input, output, cv::COLOR_BGR2GRAY);
-        std::cout << "✅ Image converted to grayscale." << std::endl;
+        cv::cvtColor(input.read(), output, cv::COLOR_BGR2GRAY);
+        LOG_DEBUG("ImageInput", "converted to grayscale node=" << name);
     } else {
-        std::cout << "⚠️ No image loaded to convert to grayscale." << std::endl;
+        LOG_WARN("ImageInput", "no image to convert to grayscale node=" << name);
     }
 }
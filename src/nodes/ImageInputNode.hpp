@@ -1,8 +1,10 @@
 #pragma once
 
 #include "../graph/Node.hpp"
+#include "../graph/ImageHandle.hpp"
 #include <opencv2/opencv.hpp>
 #include <string>
+#include <vector>
 
 class ImageInputNode : public Node {
 public:
@@ -18,15 +20,47 @@ public:
     // Manually set the output image (optional override)
     void setOutput(const cv::Mat& newOutput);
 
+    // Feed an image that was decoded elsewhere (e.g. by a batch decoder thread);
+    // process() then uses it instead of reading filePath
+    void setImage(const cv::Mat& image);
+
+    const std::string& getFilePath() const { return filePath; }
+
     // Retrieve the output image (used by downstream nodes)
     cv::Mat getOutput() const override;
 
+    // Source node: nothing can be connected to it
+    std::vector<Port> getInputPorts() const override { return {}; }
+
+    // The file path plus its modification time, so edits on disk invalidate cached results
+    ParamMap getParams() const override;
+
+    // "ImageInput" in graph files; applyParams() restores the file path
+    std::string getType() const override;
+    void applyParams(const ParamMap& params) override;
+
+    std::shared_ptr<Node> clone() const override;
+    void releaseOutputs() override;
+
+    // The decoded original is this node's only "input"
+    void releaseInputs() override;
+
     // Render GUI for this node (e.g. ImGui controls)
     void renderUI() override;
 
 private:
-    std::string name;        // Node's display name
+    // Last write time of filePath, 0 if it cannot be read
+    long long fileStamp() const;
+
+    // The loaded image downscaled by `scale`, resized from the nearest finer pyramid level
+    cv::Mat makeProxy(double scale);
+
     std::string filePath;    // Path to input image file
-    cv::Mat input;           // Original loaded image
+    ImageHandle input;           // Original loaded image
     cv::Mat output;          // Processed or modified image
+    bool preloaded = false;  // input came from setImage(), not from filePath
+    long long imageSerial = 0;  // Counts setImage() calls so each fed image gets its own cache key
+    std::string decodedPath;    // File `input` was decoded from, so a scale change does not re-read it
+    long long decodedStamp = 0;
+    std::vector<cv::Mat> pyramid;  // input, then successive pyrDown halvings, built on demand
 };
@@ -0,0 +1,46 @@
+#include "NodeFactory.hpp"
+#include "BlendNode.hpp"
+#include "BlurNode.hpp"
+#include "BrightnessContrastNode.hpp"
+#include "ColorChannelSplitterNode.hpp"
+#include "ConvolutionFilterNode.hpp"
+#include "EdgeDetectionNode.hpp"
+#include "ImageInputNode.hpp"
+#include "NoiseGenerationNode.hpp"
+#include "OutputNode.hpp"
+#include "ThresholdNode.hpp"
+#include "VideoInputNode.hpp"
+
+// Build a default node of the requested type; parameters are applied afterwards
+std::shared_ptr<Node> createNode(const std::string& type, const std::string& name) {
+    if (type == "ImageInput") {
+        return std::make_shared<ImageInputNode>(name, "");
+    } else if (type == "Output") {
+        return std::make_shared<OutputNode>(name, name, "png");
+    } else if (type == "BrightnessContrast") {
+        return std::make_shared<BrightnessContrastNode>(name, 1.0, 0);
+    } else if (type == "ColorChannelSplitter") {
+        return std::make_shared<ColorChannelSplitterNode>(name, false);
+    } else if (type == "Blur") {
+        return std::make_shared<BlurNode>(name);
+    } else if (type == "Threshold") {
+        return std::make_shared<ThresholdNode>(name);
+    } else if (type == "EdgeDetection") {
+        return std::make_shared<EdgeDetectionNode>(name);
+    } else if (type == "Blend") {
+        return std::make_shared<BlendNode>(name);
+    } else if (type == "NoiseGenerator") {
+        return std::make_shared<NoiseGeneratorNode>("noise_" + name, name);
+    } else if (type == "ConvolutionFilter") {
+        return std::make_shared<ConvolutionFilterNode>("conv_" + name, name);
+    } else if (type == "VideoInput") {
+        return std::make_shared<VideoInputNode>(name, "");
+    }
+    return nullptr;
+}
+
+// Keep in sync with createNode()
+std::vector<std::string> getNodeTypes() {
+    return {"ImageInput", "Output", "BrightnessContrast", "ColorChannelSplitter", "Blur",
+            "Threshold", "EdgeDetection", "Blend", "NoiseGenerator", "ConvolutionFilter", "VideoInput"};
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include "../graph/Node.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+// Creates a node from the type name it reports through Node::getType(), with default settings.
+// Returns nullptr for unknown types. Used to rebuild graphs from graph files.
+std::shared_ptr<Node> createNode(const std::string& type, const std::string& name);
+
+// Every type name createNode() understands
+std::vector<std::string> getNodeTypes();
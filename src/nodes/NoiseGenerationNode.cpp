@@ -1,6 +1,7 @@
 #include "NoiseGenerationNode.hpp"
+#include "../graph/Log.hpp"
 #include <opencv2/opencv.hpp>
-#include <iostream>
+#include <cmath>
 
 NoiseGeneratorNode::NoiseGeneratorNode(const std::string& id, const std::string& name) {
     this->id = id;
@@ -28,53 +29,63 @@ void NoiseGeneratorNode::setNoiseType(NoiseType type) {
             fastNoiseLite.SetNoiseType(FastNoiseLite::NoiseType_Cellular);
             break;
     }
+    markDirty();
 }
 
 void NoiseGeneratorNode::setInput(const cv::Mat& input) {
     inputImage = input;
+    markDirty();
 }
 
 void NoiseGeneratorNode::setScale(float scale) {
     this->scale = std::max(0.001f, scale);
     fastNoiseLite.SetFrequency(this->scale);
+    markDirty();
 }
 
 void NoiseGeneratorNode::setOctaves(int octaves) {
     this->octaves = std::clamp(octaves, 1, 10);
     fastNoiseLite.SetFractalOctaves(this->octaves);
+    markDirty();
 }
 
 void NoiseGeneratorNode::setPersistence(float persistence) {
     this->persistence = std::clamp(persistence, 0.0f, 1.0f);
     fastNoiseLite.SetFractalGain(this->persistence);
+    markDirty();
 }
 
 void NoiseGeneratorNode::setUseAsDisplacement(bool use) {
     useAsDisplacement = use;
+    markDirty();
 }
 
 void NoiseGeneratorNode::process() {
     if (inputImage.empty()) return;
 
+    // Noise is sampled per pixel, so a downscaled preview needs a proportionally higher
+    // frequency to show the same features
+    fastNoiseLite.SetFrequency(static_cast<float>(scale / resolutionScale));
     generateNoise();
 
     cv::Mat inputFloat;
-    inputImage.convertTo(inputFloat, CV_32FC3, 1.0 / 255.0);
+    inputImage.read().convertTo(inputFloat, CV_32FC3, 1.0 / 255.0);
 
     cv::Mat noiseResized;
-    cv::resize(output, noiseResized, inputImage.size());
+    cv::resize(output, noiseResized, inputImage.read().size());
+    useOutputAllocator(output);  // `output` held the noise field; let the graph's buffer pool provide the result
 
     if (useAsDisplacement) {
-        float strength = 20.0f;
+        float strength = displacementStrength * static_cast<float>(resolutionScale);
         cv::Mat displacementMap;
         cv::merge(std::vector<cv::Mat>{noiseResized, noiseResized, noiseResized}, displacementMap);
         displacementMap.convertTo(displacementMap, CV_32FC3);
 
-        cv::Mat mapX(inputImage.size(), CV_32FC1);
-        cv::Mat mapY(inputImage.size(), CV_32FC1);
+        cv::Mat mapX(inputImage.read().size(), CV_32FC1);
+        cv::Mat mapY(inputImage.read().size(), CV_32FC1);
 
-        for (int y = 0; y < inputImage.rows; ++y) {
-            for (int x = 0; x < inputImage.cols; ++x) {
+        for (int y = 0; y < inputImage.read().rows; ++y) {
+            for (int x = 0; x < inputImage.read().cols; ++x) {
                 float displacement = (displacementMap.at<cv::Vec3f>(y, x)[0] - 0.5f) * 2.0f * strength;
                 mapX.at<float>(y, x) = static_cast<float>(x) + displacement;
                 mapY.at<float>(y, x) = static_cast<float>(y) + displacement;
@@ -96,15 +107,23 @@ void NoiseGeneratorNode::process() {
     }
 }
 
+// A pixel moves by at most the displacement strength, plus one for bilinear sampling
+int NoiseGeneratorNode::getHalo() const {
+    if (!useAsDisplacement) {
+        return 0;
+    }
+    return static_cast<int>(std::ceil(displacementStrength * resolutionScale)) + 1;
+}
+
 void NoiseGeneratorNode::generateNoise() {
-    int width = inputImage.cols;
-    int height = inputImage.rows;
+    int width = inputImage.read().cols;
+    int height = inputImage.read().rows;
     output = cv::Mat(height, width, CV_32F);
 
     for (int y = 0; y < height; ++y) {
         for (int x = 0; x < width; ++x) {
-            float nx = static_cast<float>(x);
-            float ny = static_cast<float>(y);
+            float nx = static_cast<float>(x + regionOrigin.x);  // Frame coordinates, so regions match the full frame
+            float ny = static_cast<float>(y + regionOrigin.y);
             float noiseVal = fastNoiseLite.GetNoise(nx, ny);  // [-1, 1]
             output.at<float>(y, x) = (noiseVal + 1.0f) / 2.0f; // [0, 1]
         }
@@ -114,10 +133,50 @@ void NoiseGeneratorNode::generateNoise() {
     // cv::normalize(output, output, 0.0f, 1.0f, cv::NORM_MINMAX);
 }
 
+ParamMap NoiseGeneratorNode::getParams() const {
+    return {{"noiseType", toParam(static_cast<int>(noiseType))},
+            {"scale", toParam(scale)},
+            {"octaves", toParam(octaves)},
+            {"persistence", toParam(persistence)},
+            {"useAsDisplacement", toParam(useAsDisplacement)}};
+}
+
+std::string NoiseGeneratorNode::getType() const {
+    return "NoiseGenerator";
+}
+
+std::shared_ptr<Node> NoiseGeneratorNode::clone() const {
+    return std::make_shared<NoiseGeneratorNode>(*this);
+}
+
+// Goes through the setters so the noise engine picks up every value.
+void NoiseGeneratorNode::applyParams(const ParamMap& params) {
+    int type = static_cast<int>(noiseType);
+    if (readParam(params, "noiseType", type) && type >= 0 && type <= static_cast<int>(NoiseType::Worley)) {
+        setNoiseType(static_cast<NoiseType>(type));
+    }
+    float value = scale;
+    if (readParam(params, "scale", value)) setScale(value);
+    int layers = octaves;
+    if (readParam(params, "octaves", layers)) setOctaves(layers);
+    value = persistence;
+    if (readParam(params, "persistence", value)) setPersistence(value);
+    readParam(params, "useAsDisplacement", useAsDisplacement);
+    markDirty();
+}
+
+void NoiseGeneratorNode::releaseOutputs() {
+    output.release();
+}
+
+void NoiseGeneratorNode::releaseInputs() {
+    inputImage.release();
+}
+
 cv::Mat NoiseGeneratorNode::getOutput() const {
     return output;
 }
 
 void NoiseGeneratorNode::renderUI() {
-    std::cout << "Rendering UI for Noise Generator Node: " << name << std::endl;
+    LOG_TRACE("NoiseGenerator", "renderUI node=" << name);
 }
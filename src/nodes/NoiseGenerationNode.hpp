@@ -2,6 +2,7 @@
 
 #include "../libs/FastNoiseLite.h"
 #include "../graph/Node.hpp"
+#include "../graph/ImageHandle.hpp"
 #include <opencv2/opencv.hpp>
 #include <string>
 
@@ -21,10 +22,24 @@ public:
     void setInput(const cv::Mat& input) override;
     cv::Mat getOutput() const override;
 
+    ParamMap getParams() const override;  // Noise settings, used to cache the output
+    std::string getType() const override;                // "NoiseGenerator" in graph files
+    void applyParams(const ParamMap& params) override;   // Restores what getParams() reports
+    std::shared_ptr<Node> clone() const override;         // Copy for background evaluation
+    void releaseOutputs() override;       // Forget the output buffer before regenerating
+    void releaseInputs() override;        // Forget the input once the graph is done with it
+
+    // Displacement only moves pixels by a bounded amount, so it can run on regions;
+    // color mode normalises over the whole frame and cannot
+    bool isTileable() const override { return useAsDisplacement; }
+    int getHalo() const override;
+
     void process() override;
     void renderUI() override;
 
 private:
+    static constexpr float displacementStrength = 20.0f;  // Largest shift in pixels, at full resolution
+
     void generateNoise();  // Generates procedural noise into `output`
 
     // Parameters
@@ -35,7 +50,7 @@ private:
     bool useAsDisplacement = false;
 
     // Internal state
-    cv::Mat inputImage;
+    ImageHandle inputImage;
     cv::Mat output;
 
     // Noise engine
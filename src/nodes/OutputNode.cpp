@@ -1,5 +1,6 @@
 #include "OutputNode.hpp"
-#include <iostream>
+#include "../graph/Log.hpp"
+#include "../graph/RawImage.hpp"
 #include <opencv2/imgcodecs.hpp>
 #include <opencv2/imgproc.hpp>
 #include <imgui.h>
@@ -12,17 +13,41 @@ OutputNode::OutputNode(const std::string& name, const std::string& path, const s
 
 void OutputNode::setInput(const cv::Mat& input) {
     inputImage = input;
+    markDirty();
 }
 
 void OutputNode::process() {
     if (inputImage.empty()) {
-        std::cerr << "No input image for OutputNode: " << name << std::endl;
+        LOG_WARN("Output", "no input node=" << name);
         return;
     }
 
     // Optional preview in separate window
-    cv::imshow("Preview - " + name, inputImage);
-    cv::waitKey(1);  // non-blocking
+    if (interactive) {
+        cv::imshow("Preview - " + name, inputImage.read());
+        cv::waitKey(1);  // non-blocking
+    }
+
+    // Previews run on a downscaled proxy; only a full-resolution render is worth writing
+    if (saveOnProcess && resolutionScale >= 1.0) {
+        save(inputImage.read(), savePath);
+    }
+
+    if (interactive) {
+        cv::destroyAllWindows();
+    }
+}
+
+bool OutputNode::save(const cv::Mat& image, const std::string& basePath) const {
+    // Raw images skip the encoder entirely: header plus pixels, mapped back on load
+    if (type == "ngraw") {
+        std::string fullPath = basePath + ".ngraw";
+        bool success = writeRawImage(fullPath, image);
+        if (success) {
+            LOG_INFO("Output", "saved node=" << name << " path=" << fullPath);
+        }
+        return success;
+    }
 
     std::vector<int> compressionParams;
     if (type == "jpg" || type == "jpeg") {
@@ -33,32 +58,39 @@ void OutputNode::process() {
         compressionParams.push_back(quality / 10);  // PNG uses 0-9 compression
     }
 
-    std::string fullPath = savePath + "." + type;
-    bool success = cv::imwrite(fullPath, inputImage, compressionParams);
+    std::string fullPath = basePath + "." + type;
+    bool success = cv::imwrite(fullPath, image, compressionParams);
     if (success) {
-        std::cout << "[✅] Output saved to: " << fullPath << std::endl;
+        LOG_INFO("Output", "saved node=" << name << " path=" << fullPath);
     } else {
-        std::cerr << "[❌] Failed to save output to: " << fullPath << std::endl;
+        LOG_ERROR("Output", "save failed node=" << name << " path=" << fullPath);
     }
+    return success;
+}
 
-    cv::destroyAllWindows();
+void OutputNode::setSaveOnProcess(bool enabled) {
+    saveOnProcess = enabled;
 }
 
 void OutputNode::renderUI() {
     ImGui::Text("🖼️ Output Node: %s", name.c_str());
     
-    ImGui::SliderInt("Quality", &quality, 1, 100);
+    if (ImGui::SliderInt("Quality", &quality, 1, 100)) {
+        markDirty();
+    }
 
     static char pathBuffer[256];
     strcpy(pathBuffer, savePath.c_str());
     if (ImGui::InputText("Save Path", pathBuffer, IM_ARRAYSIZE(pathBuffer))) {
         savePath = std::string(pathBuffer);
+        markDirty();
     }
 
-    const char* formats[] = { "jpg", "png" };
-    static int formatIdx = (type == "png") ? 1 : 0;
+    const char* formats[] = { "jpg", "png", "ngraw" };
+    static int formatIdx = (type == "png") ? 1 : (type == "ngraw") ? 2 : 0;
     if (ImGui::Combo("Format", &formatIdx, formats, IM_ARRAYSIZE(formats))) {
         type = formats[formatIdx];
+        markDirty();
     }
 
     if (ImGui::Button("💾 Save Image")) {
@@ -69,8 +101,8 @@ void OutputNode::renderUI() {
     if (!inputImage.empty()) {
         cv::Mat resized;
         float maxWidth = 200.0f;
-        float scale = maxWidth / inputImage.cols;
-        cv::resize(inputImage, resized, cv::Size(), scale, scale);
+        float scale = maxWidth / inputImage.read().cols;
+        cv::resize(inputImage.read(), resized, cv::Size(), scale, scale);
 
         cv::Mat rgba;
         cv::cvtColor(resized, rgba, cv::COLOR_BGR2RGBA);
@@ -82,9 +114,38 @@ void OutputNode::renderUI() {
 }
 
 cv::Mat OutputNode::getOutput() const {
-    return inputImage;
+    pullUpstream();
+    return inputImage.read();
+}
+
+bool OutputNode::isSink() const {
+    return true;
+}
+
+ParamMap OutputNode::getParams() const {
+    return {{"savePath", savePath}, {"type", type}, {"quality", toParam(quality)}};
+}
+
+std::string OutputNode::getType() const {
+    return "Output";
+}
+
+std::shared_ptr<Node> OutputNode::clone() const {
+    return std::make_shared<OutputNode>(*this);
+}
+
+void OutputNode::applyParams(const ParamMap& params) {
+    readParam(params, "savePath", savePath);
+    readParam(params, "type", type);
+    readParam(params, "quality", quality);
+    markDirty();
+}
+
+void OutputNode::releaseInputs() {
+    inputImage.release();
 }
 
 void OutputNode::settype(const std::string &stype) {
     this->type = std::move(stype);
+    markDirty();
 }
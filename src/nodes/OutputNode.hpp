@@ -5,13 +5,15 @@
 #include <vector>
 #include <memory>
 #include "../graph/Node.hpp"
+#include "../graph/ImageHandle.hpp"
 
 class OutputNode : public Node {
 private:
-    cv::Mat inputImage;
+    ImageHandle inputImage;
     std::string savePath;
     std::string type;
     int quality = 95;  // Default quality
+    bool saveOnProcess = true;
 
 public:
     // Constructor
@@ -26,9 +28,33 @@ public:
     // Renders the UI using ImGui
     void renderUI() override;
 
-    // Gets the output (same as input for this node)
+    // Gets the output (same as input for this node); in a lazy graph this first evaluates
+    // the nodes it depends on
     cv::Mat getOutput() const override;
 
     // Sets the file type (e.g., jpg, png)
     void settype(const std::string& type);
+
+    // Encodes `image` to basePath + "." + type with this node's quality settings. The "ngraw"
+    // type writes an uncompressed raw image instead (see RawImage.hpp).
+    // Only reads the settings, so encoder threads may call it concurrently.
+    bool save(const cv::Mat& image, const std::string& basePath) const;
+
+    // When off, process() only keeps its input and leaves writing to the caller (e.g. batch encoders)
+    void setSaveOnProcess(bool enabled);
+
+    // Save path, format and quality
+    ParamMap getParams() const override;
+
+    // "Output" in graph files; applyParams() restores what getParams() reports
+    std::string getType() const override;
+    void applyParams(const ParamMap& params) override;
+
+    std::shared_ptr<Node> clone() const override;
+
+    // Forgets the image it was given (its output is the same image)
+    void releaseInputs() override;
+
+    // Results leave the graph here, so lazy graphs evaluate whatever feeds an OutputNode
+    bool isSink() const override;
 };
@@ -1,6 +1,6 @@
 #include "ThresholdNode.hpp"
+#include "../graph/Log.hpp"
 #include <opencv2/opencv.hpp>
-#include <iostream>
 #include <imgui.h>
 #include <algorithm>  
 
@@ -13,74 +13,79 @@ ThresholdNode::ThresholdNode(const std::string& name) {
 // Sets the input image for processing
 void ThresholdNode::setInput(const cv::Mat& input) {
     inputImage = input;
+    markDirty();
 }
 
 // Processes the input image based on the selected thresholding method
 void ThresholdNode::process() {
     if (inputImage.empty()) { // Check if input image is empty
-        std::cerr << "No input image for ThresholdNode: " << name << std::endl;
+        LOG_WARN("Threshold", "no input node=" << name);
         return;
     }
 
-    // Convert the image to grayscale if it's not already
-    if (inputImage.channels() != 1) {
-        cv::cvtColor(inputImage, inputImage, cv::COLOR_BGR2GRAY);
+    useOutputAllocator(outputImage);  // Let the graph's buffer pool provide the result
+
+    // Convert the image to grayscale if it's not already; the converted copy replaces the handle's
+    // view so the upstream node's pixels are left as they were
+    if (inputImage.read().channels() != 1) {
+        cv::Mat gray;
+        cv::cvtColor(inputImage.read(), gray, cv::COLOR_BGR2GRAY);
+        inputImage = gray;
     }
 
     // Apply the selected thresholding method
     switch (thresholdType) {
         case BINARY:
             // Apply binary thresholding
-            cv::threshold(inputImage, outputImage, thresholdValue, maxThresholdValue, cv::THRESH_BINARY);
+            cv::threshold(inputImage.read(), outputImage, thresholdValue, maxThresholdValue, cv::THRESH_BINARY);
             break;
         case ADAPTIVE:
             // Apply adaptive thresholding
-            cv::adaptiveThreshold(inputImage, outputImage, maxThresholdValue, cv::ADAPTIVE_THRESH_MEAN_C,
-                                  cv::THRESH_BINARY, blockSize, C);
+            cv::adaptiveThreshold(inputImage.read(), outputImage, maxThresholdValue, cv::ADAPTIVE_THRESH_MEAN_C,
+                                  cv::THRESH_BINARY, effectiveBlockSize(), C);
             break;
         case OTSU:
             // Apply Otsu's thresholding
-            cv::threshold(inputImage, outputImage, 0, maxThresholdValue, cv::THRESH_BINARY | cv::THRESH_OTSU);
+            cv::threshold(inputImage.read(), outputImage, 0, maxThresholdValue, cv::THRESH_BINARY | cv::THRESH_OTSU);
             break;
         default:
             // Handle invalid thresholding type
-            std::cerr << "Unknown thresholding method!" << std::endl;
+            LOG_ERROR("Threshold", "unknown method node=" << name << " type=" << thresholdType);
             break;
     }
 
     // Check if thresholding was successful
     if (outputImage.empty()) {
-        std::cerr << "Failed to apply thresholding." << std::endl;
+        LOG_ERROR("Threshold", "failed node=" << name);
     } else {
         // Log the applied method
-        std::cout << "Threshold applied using " << (thresholdType == BINARY ? "Binary" : 
-                                                     (thresholdType == ADAPTIVE ? "Adaptive" : "Otsu"))
-                  << " method." << std::endl;
+        LOG_DEBUG("Threshold", "applied node=" << name << " method="
+                  << (thresholdType == BINARY ? "binary" : (thresholdType == ADAPTIVE ? "adaptive" : "otsu")));
     }
 }
 
 // Renders the user interface for thresholding settings
 void ThresholdNode::renderUI() {
-    std::cout << "[ThresholdNode: " << name << "]" << std::endl;
+    LOG_TRACE("Threshold", "renderUI node=" << name);
 
     // Radio buttons to select thresholding method
     if (ImGui::RadioButton("Binary", thresholdType == BINARY)) {
         thresholdType = BINARY;
-        process(); // Reprocess image when method is changed
+        markDirty(); // Reprocess image on the next run when method is changed
     }
     if (ImGui::RadioButton("Adaptive", thresholdType == ADAPTIVE)) {
         thresholdType = ADAPTIVE;
-        process();
+        markDirty();
     }
     if (ImGui::RadioButton("Otsu", thresholdType == OTSU)) {
         thresholdType = OTSU;
-        process();
+        markDirty();
     }
 
     // Show additional UI for binary thresholding
     if (thresholdType == BINARY) {
         if (ImGui::SliderInt("Threshold Value", &thresholdValue, 0, maxThresholdValue)) {
-            process(); // Reprocess when threshold value is changed
+            markDirty(); // Reprocess when threshold value is changed
         }
     }
 
@@ -89,10 +94,10 @@ void ThresholdNode::renderUI() {
         // Slider for block size, ensures it is an odd number
         if (ImGui::SliderInt("Block Size", &blockSize, 3, 21)) {
             if (blockSize % 2 == 0) blockSize++; // Ensure odd block size
-            process();
+            markDirty();
         }
         if (ImGui::SliderInt("C Constant", &C, 1, 10)) {
-            process(); // Reprocess when constant is changed
+            markDirty(); // Reprocess when constant is changed
         }
     }
 
@@ -100,9 +105,10 @@ void ThresholdNode::renderUI() {
     if (!inputImage.empty()) {
         std::vector<int> histogram(256, 0);
         // Calculate histogram values
-        for (int i = 0; i < inputImage.rows; i++) {
-            for (int j = 0; j < inputImage.cols; j++) {
-                histogram[inputImage.at<uchar>(i, j)]++;
+        const cv::Mat& image = inputImage.read();
+        for (int i = 0; i < image.rows; i++) {
+            for (int j = 0; j < image.cols; j++) {
+                histogram[image.at<uchar>(i, j)]++;
             }
         }
 
@@ -121,26 +127,88 @@ cv::Mat ThresholdNode::getOutput() const {
     return outputImage;
 }
 
+// The output port carries a single-channel binary mask
+std::vector<Node::Port> ThresholdNode::getOutputPorts() const {
+    return {{"output", PortType::Mask}};
+}
+
+// Describes binary thresholding as a lookup table on the gray value, built with cv::threshold itself
+bool ThresholdNode::getPointwiseOp(PointwiseOp& op) const {
+    if (thresholdType != BINARY) {
+        return false; // Adaptive looks at neighbours and Otsu at the whole histogram
+    }
+
+    cv::Mat ramp(1, 256, CV_8U), mapped;
+    for (int v = 0; v < 256; ++v) {
+        ramp.at<uchar>(0, v) = static_cast<uchar>(v); // Every possible gray value
+    }
+    cv::threshold(ramp, mapped, thresholdValue, maxThresholdValue, cv::THRESH_BINARY);
+
+    op.kind = PointwiseOp::Kind::GrayMap;
+    op.table.assign(mapped.ptr<uchar>(0), mapped.ptr<uchar>(0) + 256);
+    return true;
+}
+
+// Parameters that determine the thresholded mask
+ParamMap ThresholdNode::getParams() const {
+    return {{"type", toParam(static_cast<int>(thresholdType))},
+            {"thresholdValue", toParam(thresholdValue)},
+            {"maxThresholdValue", toParam(maxThresholdValue)},
+            {"blockSize", toParam(blockSize)},
+            {"C", toParam(C)}};
+}
+
+// Graph files refer to this node as "Threshold"
+std::string ThresholdNode::getType() const {
+    return "Threshold";
+}
+
+std::shared_ptr<Node> ThresholdNode::clone() const {
+    return std::make_shared<ThresholdNode>(*this);
+}
+
+// Restores the method and its settings saved by getParams()
+void ThresholdNode::applyParams(const ParamMap& params) {
+    int type = static_cast<int>(thresholdType);
+    if (readParam(params, "type", type) && type >= BINARY && type <= OTSU) {
+        thresholdType = static_cast<ThresholdType>(type);
+    }
+    readParam(params, "thresholdValue", thresholdValue);
+    readParam(params, "maxThresholdValue", maxThresholdValue);
+    readParam(params, "blockSize", blockSize);
+    readParam(params, "C", C);
+    markDirty(); // Reprocess with the restored settings
+}
+
+void ThresholdNode::releaseOutputs() {
+    outputImage.release();
+}
+
+// Release the input so its buffer returns to the pool
+void ThresholdNode::releaseInputs() {
+    inputImage.release();
+}
+
 // Setter for threshold type (e.g., Binary, Adaptive, Otsu)
 void ThresholdNode::setThresholdType(ThresholdType type) {
     thresholdType = type;
-    process(); // Reprocess when threshold type is changed
+    markDirty(); // Reprocess when threshold type is changed
 }
 
 // Setter for threshold value (used in binary thresholding)
 void ThresholdNode::setThresholdValue(int value) {
     thresholdValue = value;
-    process(); // Reprocess when threshold value is changed
+    markDirty(); // Reprocess when threshold value is changed
 }
 
 // Setter for block size (used in adaptive thresholding)
 void ThresholdNode::setBlockSize(int size) {
     blockSize = size;
-    process(); // Reprocess when block size is changed
+    markDirty(); // Reprocess when block size is changed
 }
 
 // Setter for the C constant (used in adaptive thresholding)
 void ThresholdNode::setC(int constant) {
     C = constant;
-    process(); // Reprocess when C constant is changed
+    markDirty(); // Reprocess when C constant is changed
 }
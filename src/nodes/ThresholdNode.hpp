@@ -1,13 +1,13 @@
 #pragma once
 #include "../graph/Node.hpp"
+#include "../graph/ImageHandle.hpp"
 #include <opencv2/opencv.hpp>
-#include <iostream>
 
 // Class representing a ThresholdNode in an image processing graph
 class ThresholdNode : public Node {
 public:
     // Input image (to be processed)
-    cv::Mat inputImage;
+    ImageHandle inputImage;
 
     // Output image (processed after thresholding)
     cv::Mat outputImage;
@@ -43,6 +43,29 @@ public:
     // Get the processed output image
     cv::Mat getOutput() const override;
 
+    // The thresholded result is always single-channel, so it is published as a mask
+    std::vector<Port> getOutputPorts() const override;
+
+    // Binary and adaptive thresholds are local; Otsu picks its threshold from the whole histogram
+    bool isTileable() const override { return thresholdType != OTSU; }
+    int getHalo() const override { return thresholdType == ADAPTIVE ? effectiveBlockSize() / 2 : 0; }
+
+    // Binary thresholding of the gray value is a table lookup, so it can be fused with its neighbours
+    bool getPointwiseOp(PointwiseOp& op) const override;
+
+    // Report the method and its settings so the graph can cache the mask
+    ParamMap getParams() const override;
+
+    // "Threshold" in graph files; applyParams() restores what getParams() reports
+    std::string getType() const override;
+    void applyParams(const ParamMap& params) override;
+
+    std::shared_ptr<Node> clone() const override;
+    void releaseOutputs() override;
+
+    // Forget the input so its buffer can be recycled once the graph is done with it
+    void releaseInputs() override;
+
     // Set the thresholding type (BINARY, ADAPTIVE, or OTSU)
     void setThresholdType(ThresholdType type);
 
@@ -54,4 +77,8 @@ public:
 
     // Set the constant (C) for adaptive thresholding
     void setC(int constant);
+
+private:
+    // Block size at the current resolution scale, kept odd and at least 3 as OpenCV requires
+    int effectiveBlockSize() const { return scaledPixels(blockSize, 3) | 1; }
 };
@@ -0,0 +1,129 @@
+#include "VideoInputNode.hpp"
+#include "../graph/Log.hpp"
+#include <opencv2/opencv.hpp>
+#include <filesystem>
+#include <imgui.h>
+
+// Constructor initializes name and source path
+VideoInputNode::VideoInputNode(const std::string& name, const std::string& sourcePath)
+    : Node(), sourcePath(sourcePath) {
+    this->name = name;
+    this->id = "video_input_" + name;
+}
+
+// Take the selected frame from the decoder's ring; the decoder thread is already working ahead
+void VideoInputNode::process() {
+    if (!openDecoder()) {
+        LOG_ERROR("VideoInput", "open failed node=" << name << " path=" << sourcePath);
+        output.release();
+        atEnd = true;
+        return;
+    }
+
+    // Only ask the decoder again when a different frame is selected
+    if (frame.empty() || decodedIndex != frameIndex) {
+        atEnd = !decoder->read(frameIndex, frame);
+        decodedIndex = atEnd ? -1 : frameIndex;
+    }
+
+    if (atEnd) {
+        LOG_DEBUG("VideoInput", "end of stream node=" << name << " frame=" << frameIndex);
+        output.release();
+    } else if (resolutionScale < 1.0) {
+        // Preview: downstream nodes work on a small proxy
+        useOutputAllocator(output);
+        cv::Size target(std::max(1, static_cast<int>(std::lround(frame.cols * resolutionScale))),
+                        std::max(1, static_cast<int>(std::lround(frame.rows * resolutionScale))));
+        cv::resize(frame, output, target, 0, 0, cv::INTER_AREA);
+    } else {
+        output = frame;  // Share the decoded pixels; downstream nodes only read their inputs
+    }
+}
+
+// (Re)open the decoder when there is none yet or the source path changed
+bool VideoInputNode::openDecoder() {
+    if (!decoder || decoderPath != sourcePath) {
+        decoder = std::make_shared<FrameDecoder>(sourcePath, prefetch);
+        decoderPath = sourcePath;
+        frame.release();
+        decodedIndex = -1;
+    }
+    return decoder->isOpened();
+}
+
+// Select a frame and mark the output stale
+void VideoInputNode::setFrame(long long index) {
+    frameIndex = std::max(0LL, index);
+    markDirty();
+}
+
+// Change how far the decoder reads ahead; takes effect when the decoder is next opened
+void VideoInputNode::setPrefetch(size_t frames) {
+    if (frames != prefetch) {
+        prefetch = frames;
+        decoder.reset();
+    }
+}
+
+// Frame rate reported by the open source, 0 before the first process()
+double VideoInputNode::getFrameRate() const {
+    return decoder ? decoder->getFrameRate() : 0.0;
+}
+
+// Last write time of the source file, used to notice edits on disk
+long long VideoInputNode::fileStamp() const {
+    std::error_code error;
+    auto modified = std::filesystem::last_write_time(sourcePath, error);
+    return error ? 0 : static_cast<long long>(modified.time_since_epoch().count());
+}
+
+// Identify the frame by source, last write time and index
+ParamMap VideoInputNode::getParams() const {
+    return {{"sourcePath", sourcePath}, {"modified", toParam(fileStamp())}, {"frame", toParam(frameIndex)}};
+}
+
+// Graph files refer to this node as "VideoInput"
+std::string VideoInputNode::getType() const {
+    return "VideoInput";
+}
+
+std::shared_ptr<Node> VideoInputNode::clone() const {
+    return std::make_shared<VideoInputNode>(*this);
+}
+
+// Restore the source and frame saved by getParams(); the modification time is re-read from disk
+void VideoInputNode::applyParams(const ParamMap& params) {
+    readParam(params, "sourcePath", sourcePath);
+    readParam(params, "frame", frameIndex);
+    markDirty();
+}
+
+void VideoInputNode::releaseOutputs() {
+    output.release();
+}
+
+// Release the decoded frame so its buffer can be recycled
+void VideoInputNode::releaseInputs() {
+    frame.release();
+    decodedIndex = -1;
+}
+
+// Return the current frame
+cv::Mat VideoInputNode::getOutput() const {
+    return output;
+}
+
+// Frame slider, bounded by the frame count when the source reports one
+void VideoInputNode::renderUI() {
+    LOG_TRACE("VideoInput", "renderUI node=" << name);
+
+    long long last = decoder ? decoder->getFrameCount() - 1 : 0;
+    int selected = static_cast<int>(frameIndex);
+    if (last > 0) {
+        if (ImGui::SliderInt("Frame", &selected, 0, static_cast<int>(last))) {
+            setFrame(selected);  // Decode and reprocess from the new frame on the next run
+        }
+    } else if (ImGui::InputInt("Frame", &selected)) {
+        setFrame(selected);
+    }
+}
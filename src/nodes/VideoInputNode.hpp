@@ -0,0 +1,70 @@
+#pragma once
+
+#include "../graph/Node.hpp"
+#include "../graph/FrameDecoder.hpp"
+#include <opencv2/opencv.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+class VideoInputNode : public Node {
+public:
+    // Constructor: Takes a name and a video file or image-sequence pattern ("frames/%04d.png")
+    VideoInputNode(const std::string& name, const std::string& sourcePath);
+
+    // Fetch the selected frame from the background decoder
+    void process() override;
+
+    // Select the frame the next process() produces (0 is the first)
+    void setFrame(long long index);
+    long long getFrame() const { return frameIndex; }
+
+    // True once process() found no frame at the selected index (end of the footage)
+    bool isAtEnd() const { return atEnd; }
+
+    // Frames decoded ahead of the one being processed
+    void setPrefetch(size_t frames);
+
+    // As reported by the source; 0 when unknown
+    double getFrameRate() const;
+
+    // Retrieve the current frame (used by downstream nodes)
+    cv::Mat getOutput() const override;
+
+    // Source node: nothing can be connected to it
+    std::vector<Port> getInputPorts() const override { return {}; }
+
+    // Source path, its modification time and the frame index, so every frame gets its own cache key
+    ParamMap getParams() const override;
+
+    // "VideoInput" in graph files; applyParams() restores what getParams() reports
+    std::string getType() const override;
+    void applyParams(const ParamMap& params) override;
+
+    // Copy with the same settings and frame; the copy shares the decoder
+    std::shared_ptr<Node> clone() const override;
+    void releaseOutputs() override;
+
+    // Forget the decoded full-resolution frame
+    void releaseInputs() override;
+
+    // Render GUI for this node (frame slider)
+    void renderUI() override;
+
+private:
+    // Last write time of sourcePath, 0 if it cannot be read (e.g. a sequence pattern)
+    long long fileStamp() const;
+
+    // Opens the decoder for sourcePath unless it is already open
+    bool openDecoder();
+
+    std::string sourcePath;       // Video file or image-sequence pattern
+    long long frameIndex = 0;     // Frame process() produces
+    size_t prefetch = 8;          // Capacity of the decoder's ring
+    bool atEnd = false;           // No frame at frameIndex
+    std::shared_ptr<FrameDecoder> decoder;  // Shared with clones; reopened when the source changes
+    std::string decoderPath;      // Source the decoder was opened for
+    cv::Mat frame;                // Decoded frame at full resolution
+    long long decodedIndex = -1;  // Index of `frame`
+    cv::Mat output;               // `frame`, downscaled in preview mode
+};